@@ -0,0 +1,78 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef CAYENNE_BENCHMARK_HPP
+#define CAYENNE_BENCHMARK_HPP
+
+#include <Arduino.h>
+#include "CayenneLPP.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Prints one benchmark result line as "<name>: <cycles> cycles/frame".
+     *
+     * @param out The stream to print to.
+     * @param name The name of the encoder path.
+     * @param elapsedMicros Total time spent in the measured loop.
+     * @param iterations Number of frames encoded in the measured loop.
+     */
+    static inline void printBenchmarkResult(Print &out, const __FlashStringHelper *name, const uint32_t elapsedMicros, const uint16_t iterations)
+    {
+        out.print(name);
+        out.print(F(": "));
+        out.print((elapsedMicros * (F_CPU / 1000000UL)) / iterations);
+        out.println(F(" cycles/frame"));
+    }
+
+    /**
+     * @brief Measures the float and the integer fixed-point encoder paths on the target.
+     *
+     * Both loops encode the same KISSLoRa-like frame (temperature, humidity, VDD and an accelerometer
+     * reading) from raw sensor codes. The float loop converts the codes to float first, like the
+     * sketches do today; the fixed-point loop hands the codes straight to FixedPoint. The cycle
+     * count is derived from micros(), so run enough iterations to hide its resolution.
+     *
+     * @param out The stream to print the results to.
+     * @param iterations Number of frames to encode per path.
+     */
+    static inline void benchmarkFixedPoint(Print &out, const uint16_t iterations = 1000)
+    {
+        CayenneLPP<51> lpp(51);
+        volatile uint16_t tempCode = 0x6A3C; // ~25.8 °C
+        volatile uint16_t rhCode = 0x7B10;   // ~54.1 %RH
+        volatile uint16_t adcCode = 512;     // ~1.28 V
+        volatile int16_t accX = 12, accY = -30, accZ = 1024;
+        volatile size_t sink = 0;
+
+        uint32_t start = micros();
+        for (uint16_t i = 0; i < iterations; i++)
+        {
+            lpp.reset();
+            lpp.addTemperature(0, (175.25f * tempCode / 65536) - 46.85f);
+            lpp.addHumidity(1, (125.0f * rhCode / 65536) - 6);
+            lpp.addAnalogInput(2, adcCode * (2.56f / 1023.0f));
+            lpp.addAccelerometer(3, accX / 1024.0f, accY / 1024.0f, accZ / 1024.0f);
+            sink = lpp.getSize();
+        }
+        printBenchmarkResult(out, F("float"), micros() - start, iterations);
+
+        start = micros();
+        for (uint16_t i = 0; i < iterations; i++)
+        {
+            lpp.reset();
+            lpp.addTemperature(0, FixedPoint(tempCode, 17525, 655360, -307036160L));
+            lpp.addHumidity(1, FixedPoint(rhCode, 1250, 65536, -3932160L));
+            lpp.addAnalogInput(2, FixedPoint(adcCode, 256, 1023));
+            lpp.addAccelerometer(3, FixedPoint(accX, 2000, 2048), FixedPoint(accY, 2000, 2048), FixedPoint(accZ, 2000, 2048));
+            sink = lpp.getSize();
+        }
+        printBenchmarkResult(out, F("fixed-point"), micros() - start, iterations);
+        (void)sink;
+    }
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // CAYENNE_BENCHMARK_HPP
@@ -14,6 +14,72 @@
 
 namespace PAYLOAD_ENCODER
 {
+    /**
+     * @brief Integer fixed-point input for the scaled add* functions.
+     *
+     * Holds a value that is already expressed in the resolution of the LPP field it is added to
+     * (e.g. 0.1 °C for temperature, 0.001 G for the accelerometer). It can be built directly from
+     * a pre-scaled integer, or from a raw sensor code plus an integer scale:
+     *
+     *     value = round((raw * mul + bias) / div)
+     *
+     * All arithmetic is done in int32_t, so no soft-float code is pulled in on FPU-less MCUs.
+     * The caller must make sure raw * mul + bias fits in an int32_t.
+     *
+     * Examples (field resolution in brackets):
+     *  - Si7021 temperature code [0.1 °C]: FixedPoint(code, 17525, 655360, -307036160) (= 175.25 * code / 65536 - 46.85)
+     *  - Si7021 humidity code [0.1 %]: FixedPoint(code, 1250, 65536, -3932160) (= 125 * code / 65536 - 6)
+     *  - FXLS8471Q 12 bit count at +-2 G [0.001 G]: FixedPoint(count, 2000, 2048)
+     *  - 10 bit ADC count at 2.56 V reference [0.01]: FixedPoint(count, 256, 1023)
+     */
+    class FixedPoint
+    {
+    public:
+        /**
+         * @brief Creates a fixed-point value from an integer that is already scaled to the field resolution.
+         *
+         * @param scaled The value in units of the field resolution.
+         */
+        explicit constexpr FixedPoint(const int32_t scaled) : value(scaled) {}
+
+        /**
+         * @brief Creates a fixed-point value from a raw sensor code and an integer scale.
+         *
+         * @param raw The raw sensor code or ADC count.
+         * @param mul Multiplier applied to the raw value.
+         * @param div Divisor applied after multiplying and adding the bias. Must be greater than 0.
+         * @param bias Offset added before the division, in units of raw * mul.
+         */
+        constexpr FixedPoint(const int32_t raw, const int32_t mul, const int32_t div, const int32_t bias = 0)
+            : value(roundDiv(raw * mul + bias, div)) {}
+
+        /**
+         * @brief Returns the value in units of the field resolution.
+         *
+         * @return int32_t The scaled value.
+         */
+        constexpr int32_t get() const
+        {
+            return value;
+        }
+
+    private:
+        int32_t value;
+
+        /**
+         * @brief Integer division that rounds half away from zero, like round_and_cast() in CayenneLPP.
+         *
+         * @param numerator The value to divide.
+         * @param denominator The divisor, must be greater than 0.
+         * @return int32_t The rounded quotient.
+         */
+        static constexpr int32_t roundDiv(const int32_t numerator, const int32_t denominator)
+        {
+            return numerator >= 0 ? (numerator + denominator / 2) / denominator
+                                  : (numerator - denominator / 2) / denominator;
+        }
+    };
+
     /**
      * @brief Template class for CayenneLPP payload encoder.
      *
@@ -26,9 +92,9 @@ namespace PAYLOAD_ENCODER
         /**
          * @brief Constructor for CayenneLPP.
          *
-         * @param size Size of the buffer.
+         * @param size Size of the buffer, MaxSize when omitted (e.g. for arrays of encoders).
          */
-        explicit CayenneLPP(const uint8_t size) : operationalSize(size > MaxSize ? MaxSize : size), currentIndex(0) 
+        explicit CayenneLPP(const uint8_t size = MaxSize > 0xFF ? 0xFF : MaxSize) : operationalSize(size > MaxSize ? MaxSize : size), currentIndex(0) 
         {
             for(size_t i = 0; i < MaxSize; i++) {
                 buffer[i] = 0;
@@ -84,6 +150,30 @@ namespace PAYLOAD_ENCODER
             currentIndex = 0; // Reset currentIndex when buffer is reset
         }
 
+        /**
+         * @brief Changes the operational size, e.g. to TheThingsNetwork::getMaxPayload() before each frame.
+         *
+         * @param size New size of the buffer, limited to MaxSize. It is not reduced below the size already in use.
+         */
+        void setOperationalSize(const uint8_t size)
+        {
+            operationalSize = size > MaxSize ? MaxSize : size;
+            if (operationalSize < currentIndex)
+            {
+                operationalSize = currentIndex;
+            }
+        }
+
+        /**
+         * @brief Gets the operational size of the buffer.
+         *
+         * @return size_t Maximum number of bytes a frame may use.
+         */
+        size_t getOperationalSize(void) const
+        {
+            return operationalSize;
+        }
+
         /**
          * @brief Gets the size of the buffer.
          *
@@ -120,6 +210,29 @@ namespace PAYLOAD_ENCODER
             return static_cast<uint8_t>(currentIndex);
         }
 
+        /**
+         * @brief Returns a mark of the current size, to remove the fields added after it with rollback().
+         *
+         * @return size_t The mark.
+         */
+        size_t checkpoint(void) const
+        {
+            return currentIndex;
+        }
+
+        /**
+         * @brief Removes all fields added after a checkpoint().
+         *
+         * @param mark A mark from checkpoint(); marks beyond the current size are ignored.
+         */
+        void rollback(const size_t mark)
+        {
+            if (mark < currentIndex)
+            {
+                currentIndex = mark;
+            }
+        }
+
         /* END of REQUIRED FUNCTIONS by ASSIGNMENT #1 */
 
         /**
@@ -310,6 +423,348 @@ namespace PAYLOAD_ENCODER
             return addField(DATA_TYPES::GPS_LOC, sensorChannel, lat, lon, alt);
         }
 
+        /**
+         * @brief Adds a generic sensor field (4 bytes unsigned) to the payload.
+         *
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The value.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addGenericSensor(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return addField(DATA_TYPES::GEN_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a voltage field to the payload.
+         *
+         * @param sensorChannel The channel number of the voltage sensor.
+         * @param value The voltage in V, with a precision of 0.01 V.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addVoltage(const uint8_t sensorChannel, const float value)
+        {
+            return addField(DATA_TYPES::VOLT_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a current field to the payload.
+         *
+         * @param sensorChannel The channel number of the current sensor.
+         * @param value The current in A, with a precision of 0.001 A.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addCurrent(const uint8_t sensorChannel, const float value)
+        {
+            return addField(DATA_TYPES::CURR_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a frequency field to the payload.
+         *
+         * @param sensorChannel The channel number of the frequency sensor.
+         * @param value The frequency in Hz.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addFrequency(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return addField(DATA_TYPES::FREQ_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a percentage field to the payload.
+         *
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The percentage, 0 to 100.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addPercentage(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return addField(DATA_TYPES::PERC_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds an altitude field to the payload.
+         *
+         * @param sensorChannel The channel number of the altitude sensor.
+         * @param value The altitude in meters, with a precision of 1 m.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addAltitude(const uint8_t sensorChannel, const float value)
+        {
+            return addField(DATA_TYPES::ALT_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a concentration field to the payload.
+         *
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The concentration in ppm.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addConcentration(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return addField(DATA_TYPES::CONC_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a power field to the payload.
+         *
+         * @param sensorChannel The channel number of the power sensor.
+         * @param value The power in W.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addPower(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return addField(DATA_TYPES::PWR_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a distance field to the payload.
+         *
+         * @param sensorChannel The channel number of the distance sensor.
+         * @param value The distance in meters, with a precision of 0.001 m.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addDistance(const uint8_t sensorChannel, const float value)
+        {
+            return addField(DATA_TYPES::DIST_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds an energy field to the payload.
+         *
+         * @param sensorChannel The channel number of the energy meter.
+         * @param value The energy in kWh, with a precision of 0.001 kWh.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addEnergy(const uint8_t sensorChannel, const float value)
+        {
+            return addField(DATA_TYPES::ENRG_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a direction field to the payload.
+         *
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The direction in degrees, 0 to 359.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addDirection(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return addField(DATA_TYPES::DIR_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a Unix time field to the payload.
+         *
+         * @param sensorChannel The channel number of the clock.
+         * @param value Seconds since 1970-01-01 00:00 UTC.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addUnixTime(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return addField(DATA_TYPES::UNIX_TIME, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a colour field to the payload.
+         *
+         * @param sensorChannel The channel number of the colour sensor.
+         * @param r The red component.
+         * @param g The green component.
+         * @param b The blue component.
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addColour(const uint8_t sensorChannel, const uint8_t r, const uint8_t g, const uint8_t b)
+        {
+            return addField(DATA_TYPES::COLOUR, sensorChannel, r, g, b);
+        }
+
+        /**
+         * @brief Adds a switch field to the payload.
+         *
+         * @param sensorChannel The channel number of the switch.
+         * @param value The state of the switch (0 or 1).
+         * @return uint8_t Returns the new size of the payload, or 0 if the field could not be appended.
+         */
+        const uint8_t addSwitch(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return addField(DATA_TYPES::SWITCH, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a single-value field of up to 3 bytes; size and resolution come from the type table.
+         *
+         * Works for the types in DATA_TYPE_INFO with 1 to 3 byte values, also ones without a dedicated add
+         * function. 4-byte types (generic, frequency, distance, energy, unix time) are rejected: a float has a
+         * 24-bit mantissa and would round them, e.g. 1700000123 s to 1700000128 s. Use the FixedPoint overload
+         * or the uint32_t add functions, e.g. addUnixTime(), for them.
+         *
+         * @param dataType The data type.
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The value in its unit, e.g. 21.5 for 21.5 °C.
+         * @return uint8_t Returns the new size of the payload, or 0 for unknown, multi-value and 4-byte types and
+         *                 if the field could not be appended.
+         */
+        const uint8_t addValue(const DATA_TYPES dataType, const uint8_t sensorChannel, const float value)
+        {
+            if (getDataTypeValueCount(dataType) != 1 || getDataTypeSize(dataType) > 3)
+            {
+                return 0;
+            }
+            return addField(dataType, sensorChannel, value);
+        }
+
+        /* Integer fixed-point variants of the scaled fields. These produce the same bytes as the
+         * float versions, but never touch float arithmetic. See FixedPoint for the input format. */
+
+        /**
+         * @brief Adds an analog input field from a fixed-point value in 0.01 units.
+         *
+         * @param sensorChannel The channel number of the analog input sensor.
+         * @param value The analog value in 0.01 units.
+         * @return uint8_t Returns the new size of the payload after adding the analog input.
+         */
+        const uint8_t addAnalogInput(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return addField(DATA_TYPES::ANL_IN, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds an analog output field from a fixed-point value in 0.01 units.
+         *
+         * @param sensorChannel The channel number of the analog output sensor.
+         * @param value The analog value in 0.01 units.
+         * @return uint8_t Returns the new size of the payload after adding the analog output.
+         */
+        const uint8_t addAnalogOutput(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return addField(DATA_TYPES::ANL_OUT, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a temperature field from a fixed-point value in 0.1 °C.
+         *
+         * @param sensorChannel The channel number of the temperature sensor.
+         * @param value The temperature in 0.1 °C.
+         * @return uint8_t Returns the new size of the payload after adding the temperature value.
+         */
+        const uint8_t addTemperature(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return addField(DATA_TYPES::TEMP_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a humidity field from a fixed-point value in 0.1 %.
+         *
+         * @param sensorChannel The channel number of the humidity sensor.
+         * @param value The relative humidity in 0.1 %.
+         * @return uint8_t Returns the new size of the payload after adding the humidity value. Returns 0 if
+         *                 there was an error or if the payload could not be appended.
+         */
+        const uint8_t addHumidity(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return addField(DATA_TYPES::HUM_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds an accelerometer field from fixed-point values in 0.001 G per axis.
+         *
+         * @param sensorChannel The channel number of the accelerometer sensor.
+         * @param x The acceleration along the x-axis in 0.001 G.
+         * @param y The acceleration along the y-axis in 0.001 G.
+         * @param z The acceleration along the z-axis in 0.001 G.
+         * @return uint8_t Returns the new size of the payload after adding the accelerometer data. Returns 0 if
+         *                 there was an error or if the payload could not be appended.
+         */
+        const uint8_t addAccelerometer(const uint8_t sensorChannel, const FixedPoint x, const FixedPoint y, const FixedPoint z)
+        {
+            return addField(DATA_TYPES::ACCRM_SENS, sensorChannel, x, y, z);
+        }
+
+        /**
+         * @brief Adds a barometric pressure field from a fixed-point value in 0.1 hPa.
+         *
+         * @param sensorChannel The channel number of the barometer sensor.
+         * @param value The barometric pressure in 0.1 hPa.
+         * @return uint8_t Returns the new size of the payload after adding the barometric pressure value.
+         *                 Returns 0 if there was an error or if the payload could not be appended.
+         */
+        const uint8_t addBarometer(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return addField(DATA_TYPES::BARO_SENS, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a gyroscope field from fixed-point values in 0.01 °/s per axis.
+         *
+         * @param sensorChannel The channel number of the gyroscope sensor.
+         * @param x The angular velocity around the x-axis in 0.01 °/s.
+         * @param y The angular velocity around the y-axis in 0.01 °/s.
+         * @param z The angular velocity around the z-axis in 0.01 °/s.
+         * @return uint8_t Returns the new size of the payload after adding the gyroscope data. Returns 0 if
+         *                 there was an error or if the payload could not be appended.
+         */
+        const uint8_t addGyroscope(const uint8_t sensorChannel, const FixedPoint x, const FixedPoint y, const FixedPoint z)
+        {
+            return addField(DATA_TYPES::GYRO_SENS, sensorChannel, x, y, z);
+        }
+
+        /**
+         * @brief Adds a GPS location field from fixed-point values.
+         *
+         * @param sensorChannel The channel number of the GPS sensor.
+         * @param lat The latitude in 0.0001°.
+         * @param lon The longitude in 0.0001°.
+         * @param alt The altitude in 0.01 meter.
+         * @return uint8_t Returns the new size of the payload after adding the GPS location data. Returns 0 if
+         *                 there was an error or if the payload could not be appended.
+         */
+        const uint8_t addGPSLocation(const uint8_t sensorChannel, const FixedPoint lat, const FixedPoint lon, const FixedPoint alt)
+        {
+            return addField(DATA_TYPES::GPS_LOC, sensorChannel, lat, lon, alt);
+        }
+
+        /**
+         * @brief Adds a single-value field of any type from a fixed-point value in the resolution of the type.
+         *
+         * @param dataType The data type.
+         * @param sensorChannel The channel number of the sensor.
+         * @param value The value in units of the type resolution, e.g. 215 for 21.5 °C.
+         * @return uint8_t Returns the new size of the payload, or 0 for unknown or multi-value types and if the
+         *                 field could not be appended.
+         */
+        const uint8_t addValue(const DATA_TYPES dataType, const uint8_t sensorChannel, const FixedPoint value)
+        {
+            if (getDataTypeValueCount(dataType) != 1)
+            {
+                return 0;
+            }
+            return addField(dataType, sensorChannel, value);
+        }
+
+        /**
+         * @brief Adds a three-value field of any type (xyz, colour or GPS) from fixed-point values.
+         *
+         * @param dataType The data type.
+         * @param sensorChannel The channel number of the sensor.
+         * @param first The first value in units of the type resolution.
+         * @param second The second value in units of the type resolution.
+         * @param third The third value in units of the type resolution (GPS altitude: 0.01 m).
+         * @return uint8_t Returns the new size of the payload, or 0 for types that do not carry three values and if
+         *                 the field could not be appended.
+         */
+        const uint8_t addValue(const DATA_TYPES dataType, const uint8_t sensorChannel,
+            const FixedPoint first, const FixedPoint second, const FixedPoint third)
+        {
+            if (getDataTypeValueCount(dataType) != 3)
+            {
+                return 0;
+            }
+            return addField(dataType, sensorChannel, first, second, third);
+        }
+
     private:
         uint8_t buffer[MaxSize];
         size_t operationalSize;
@@ -411,6 +866,21 @@ namespace PAYLOAD_ENCODER
             currentIndex += sizeof(T);
         }
 
+        /**
+         * @brief Appends the lowest bytes of a value, least significant byte first like appendData().
+         *
+         * @param value The value to be appended.
+         * @param width Number of bytes to append (1..4).
+         */
+        void appendValue(const int32_t value, const size_t width)
+        {
+            const uint32_t raw = static_cast<uint32_t>(value);
+            for (size_t i = 0; i < width; i++)
+            {
+                buffer[currentIndex++] = static_cast<uint8_t>(raw >> (8 * i));
+            }
+        }
+
         /**
          * @brief Adds a field with a single-byte value to the payload.
          * 
@@ -457,11 +927,55 @@ namespace PAYLOAD_ENCODER
             return currentIndex;
         }
 
+        /**
+         * @brief Adds a field with a four-byte value to the payload.
+         *
+         * @param dataType The data type identifier for the sensor data being appended.
+         * @param sensorChannel The channel number associated with the sensor data.
+         * @param value The four-byte sensor data value to be appended.
+         * @return uint8_t Returns the new current index in the buffer after appending the data.
+         *                 Returns 0 if there was insufficient capacity to append the data.
+         */
+        const uint8_t addFieldImpl(const DATA_TYPES dataType, const uint8_t sensorChannel, const uint32_t value)
+        {
+            if (!checkCapacity(6)) {
+                return 0;
+            }
+            appendHeader(dataType, sensorChannel);
+            appendData(value);
+            return currentIndex;
+        }
+
+        /**
+         * @brief Adds a field with three single-byte values (colour) to the payload.
+         *
+         * @param dataType The data type identifier for the sensor data being appended.
+         * @param sensorChannel The channel number associated with the sensor data.
+         * @param first The first value.
+         * @param second The second value.
+         * @param third The third value.
+         * @return uint8_t Returns the new current index in the buffer after appending the data.
+         *                 Returns 0 if there was insufficient capacity to append the data.
+         */
+        const uint8_t addFieldImpl(const DATA_TYPES dataType, const uint8_t sensorChannel,
+            const uint8_t first, const uint8_t second, const uint8_t third)
+        {
+            if (!checkCapacity(5)) {
+                return 0;
+            }
+            appendHeader(dataType, sensorChannel);
+            buffer[currentIndex++] = first;
+            buffer[currentIndex++] = second;
+            buffer[currentIndex++] = third;
+            return currentIndex;
+        }
+
         /**
          * @brief Adds a field with a scaled float value to the payload.
          * 
          * Appends a sensor data field to the payload, including a header (data type and sensor channel)
-         * followed by a float value that is scaled and cast to a two-byte integer before appending.
+         * followed by a float value that is scaled with the resolution of the type and stored in the
+         * number of bytes the type table declares for it.
          * This is typically used for sensor data like temperature, humidity, etc., that need scaling.
          * 
          * @param dataType The data type identifier for the sensor data being appended.
@@ -472,13 +986,12 @@ namespace PAYLOAD_ENCODER
          */
         const uint8_t addFieldImpl(const DATA_TYPES dataType, const uint8_t sensorChannel, const float value)
         {
-            const uint16_t resolution = FLOATING_DATA_RESOLUTION(dataType);
-            int16_t scaledValue = round_and_cast_int16(value * resolution);
-            if (!checkCapacity(4)) {
+            const size_t dataSize = getDataTypeSize(dataType);
+            if (dataSize == 0 || !checkCapacity(dataSize + 2)) {
                 return 0;
             }
             appendHeader(dataType, sensorChannel);
-            appendData(scaledValue);
+            appendValue(round_and_cast(value * FLOATING_DATA_RESOLUTION(dataType)), dataSize);
             return currentIndex;
         }
 
@@ -524,6 +1037,58 @@ namespace PAYLOAD_ENCODER
             return currentIndex;
         }
 
+        /**
+         * @brief Adds a field with a fixed-point value to the payload.
+         *
+         * Integer counterpart of the scaled float overload. The value is already in the resolution
+         * of the data type, so it is only narrowed to the size of the type before appending.
+         *
+         * @param dataType The data type identifier for the sensor data being appended.
+         * @param sensorChannel The channel number associated with the sensor data.
+         * @param value The fixed-point sensor data value to be appended.
+         * @return uint8_t Returns the new current index in the buffer after appending the data.
+         *                 Returns 0 if there was insufficient capacity to append the data.
+         */
+        const uint8_t addFieldImpl(const DATA_TYPES dataType, const uint8_t sensorChannel, const FixedPoint value)
+        {
+            const size_t dataSize = getDataTypeSize(dataType);
+            if (dataSize == 0 || !checkCapacity(dataSize + 2)) {
+                return 0;
+            }
+            appendHeader(dataType, sensorChannel);
+            appendValue(value.get(), dataSize);
+            return currentIndex;
+        }
+
+        /**
+         * @brief Adds a field with three fixed-point values to the payload.
+         *
+         * Integer counterpart of the three float overload. Every value is narrowed to a third of the
+         * type size: four bytes for GPS locations, two for the xyz types and one for colour.
+         *
+         * @param dataType The data type identifier for the sensor data being appended.
+         * @param sensorChannel The channel number associated with the sensor data.
+         * @param first The first fixed-point value (e.g., latitude or x-axis acceleration).
+         * @param second The second fixed-point value (e.g., longitude or y-axis acceleration).
+         * @param third The third fixed-point value (e.g., altitude or z-axis acceleration).
+         * @return uint8_t Returns the new current index in the buffer after appending the data.
+         *                 Returns 0 if there was insufficient capacity to append the data.
+         */
+        const uint8_t addFieldImpl(const DATA_TYPES dataType, const uint8_t sensorChannel,
+            const FixedPoint first, const FixedPoint second, const FixedPoint third)
+        {
+            const size_t totalBytes = getDataTypeSize(dataType) + 2;
+            if (!checkCapacity(totalBytes))
+                return 0;
+
+            appendHeader(dataType, sensorChannel);
+            const size_t width = (totalBytes - 2) / 3;
+            appendValue(first.get(), width);
+            appendValue(second.get(), width);
+            appendValue(third.get(), width);
+            return currentIndex;
+        }
+
         /**
          * @brief Dispatches the call to the appropriate addFieldImpl overload based on the argument types.
          * 
@@ -0,0 +1,306 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef CAYENNE_LPP_STREAM_HPP
+#define CAYENNE_LPP_STREAM_HPP
+
+#include <Arduino.h>
+#include "CayenneLPP.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Size of the largest Cayenne LPP field: header plus a GPS location.
+     */
+    static const uint8_t CAYENNE_MAX_FIELD_SIZE = 14;
+
+    /**
+     * @brief Cayenne LPP encoder that writes every field to a Print as soon as it is added.
+     *
+     * Produces exactly the same bytes as CayenneLPP, but only one field is held in RAM at a time.
+     * It is meant to be used inside Printable::printTo(), so TheThingsNetwork::sendBytes(const Printable &)
+     * can stream the frame as hex straight into the modem:
+     *
+     *     class WeatherFrame : public Printable
+     *     {
+     *     public:
+     *         float temperature, humidity;
+     *         size_t printTo(Print &out) const
+     *         {
+     *             PAYLOAD_ENCODER::CayenneLPPStream lpp(out, 51);
+     *             lpp.addTemperature(1, temperature);
+     *             lpp.addHumidity(2, humidity);
+     *             return lpp.getSize();
+     *         }
+     *     };
+     *
+     * A field that would exceed the operational size is not written and its add function returns 0,
+     * like CayenneLPP does when its buffer is full.
+     */
+    class CayenneLPPStream
+    {
+    public:
+        /**
+         * @brief Constructor for CayenneLPPStream.
+         *
+         * @param out The Print the fields are written to.
+         * @param size Maximum size of the frame, normally the max payload of the current data rate.
+         */
+        CayenneLPPStream(Print &out, const uint8_t size) : out(out), operationalSize(size), written(0), field(CAYENNE_MAX_FIELD_SIZE) {}
+
+        /**
+         * @brief Gets the number of bytes written so far.
+         * @return size_t Size of the frame.
+         */
+        size_t getSize(void) const
+        {
+            return written;
+        }
+
+        /** @brief Streams a digital input field, see CayenneLPP::addDigitalInput(). */
+        const uint8_t addDigitalInput(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return flush(field.addDigitalInput(sensorChannel, value));
+        }
+
+        /** @brief Streams a digital output field, see CayenneLPP::addDigitalOutput(). */
+        const uint8_t addDigitalOutput(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return flush(field.addDigitalOutput(sensorChannel, value));
+        }
+
+        /** @brief Streams an analog input field, see CayenneLPP::addAnalogInput(). */
+        const uint8_t addAnalogInput(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addAnalogInput(sensorChannel, value));
+        }
+
+        /** @brief Streams an analog output field, see CayenneLPP::addAnalogOutput(). */
+        const uint8_t addAnalogOutput(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addAnalogOutput(sensorChannel, value));
+        }
+
+        /** @brief Streams an illumination field, see CayenneLPP::addIllumination(). */
+        const uint8_t addIllumination(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return flush(field.addIllumination(sensorChannel, value));
+        }
+
+        /** @brief Streams a presence field, see CayenneLPP::addPresence(). */
+        const uint8_t addPresence(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return flush(field.addPresence(sensorChannel, value));
+        }
+
+        /** @brief Streams a temperature field, see CayenneLPP::addTemperature(). */
+        const uint8_t addTemperature(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addTemperature(sensorChannel, value));
+        }
+
+        /** @brief Streams a humidity field, see CayenneLPP::addHumidity(). */
+        const uint8_t addHumidity(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addHumidity(sensorChannel, value));
+        }
+
+        /** @brief Streams an accelerometer field, see CayenneLPP::addAccelerometer(). */
+        const uint8_t addAccelerometer(const uint8_t sensorChannel, const float x, const float y, const float z)
+        {
+            return flush(field.addAccelerometer(sensorChannel, x, y, z));
+        }
+
+        /** @brief Streams a barometer field, see CayenneLPP::addBarometer(). */
+        const uint8_t addBarometer(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addBarometer(sensorChannel, value));
+        }
+
+        /** @brief Streams a gyroscope field, see CayenneLPP::addGyroscope(). */
+        const uint8_t addGyroscope(const uint8_t sensorChannel, const float x, const float y, const float z)
+        {
+            return flush(field.addGyroscope(sensorChannel, x, y, z));
+        }
+
+        /** @brief Streams a GPS location field, see CayenneLPP::addGPSLocation(). */
+        const uint8_t addGPSLocation(const uint8_t sensorChannel, const float lat, const float lon, const float alt)
+        {
+            return flush(field.addGPSLocation(sensorChannel, lat, lon, alt));
+        }
+
+        /** @brief Streams a generic sensor field, see CayenneLPP::addGenericSensor(). */
+        const uint8_t addGenericSensor(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return flush(field.addGenericSensor(sensorChannel, value));
+        }
+
+        /** @brief Streams a voltage field, see CayenneLPP::addVoltage(). */
+        const uint8_t addVoltage(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addVoltage(sensorChannel, value));
+        }
+
+        /** @brief Streams a current field, see CayenneLPP::addCurrent(). */
+        const uint8_t addCurrent(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addCurrent(sensorChannel, value));
+        }
+
+        /** @brief Streams a frequency field, see CayenneLPP::addFrequency(). */
+        const uint8_t addFrequency(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return flush(field.addFrequency(sensorChannel, value));
+        }
+
+        /** @brief Streams a percentage field, see CayenneLPP::addPercentage(). */
+        const uint8_t addPercentage(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return flush(field.addPercentage(sensorChannel, value));
+        }
+
+        /** @brief Streams an altitude field, see CayenneLPP::addAltitude(). */
+        const uint8_t addAltitude(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addAltitude(sensorChannel, value));
+        }
+
+        /** @brief Streams a concentration field, see CayenneLPP::addConcentration(). */
+        const uint8_t addConcentration(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return flush(field.addConcentration(sensorChannel, value));
+        }
+
+        /** @brief Streams a power field, see CayenneLPP::addPower(). */
+        const uint8_t addPower(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return flush(field.addPower(sensorChannel, value));
+        }
+
+        /** @brief Streams a distance field, see CayenneLPP::addDistance(). */
+        const uint8_t addDistance(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addDistance(sensorChannel, value));
+        }
+
+        /** @brief Streams an energy field, see CayenneLPP::addEnergy(). */
+        const uint8_t addEnergy(const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addEnergy(sensorChannel, value));
+        }
+
+        /** @brief Streams a direction field, see CayenneLPP::addDirection(). */
+        const uint8_t addDirection(const uint8_t sensorChannel, const uint16_t value)
+        {
+            return flush(field.addDirection(sensorChannel, value));
+        }
+
+        /** @brief Streams a Unix time field, see CayenneLPP::addUnixTime(). */
+        const uint8_t addUnixTime(const uint8_t sensorChannel, const uint32_t value)
+        {
+            return flush(field.addUnixTime(sensorChannel, value));
+        }
+
+        /** @brief Streams a colour field, see CayenneLPP::addColour(). */
+        const uint8_t addColour(const uint8_t sensorChannel, const uint8_t r, const uint8_t g, const uint8_t b)
+        {
+            return flush(field.addColour(sensorChannel, r, g, b));
+        }
+
+        /** @brief Streams a switch field, see CayenneLPP::addSwitch(). */
+        const uint8_t addSwitch(const uint8_t sensorChannel, const uint8_t value)
+        {
+            return flush(field.addSwitch(sensorChannel, value));
+        }
+
+        /** @brief Streams a single-value field of up to 3 bytes, see CayenneLPP::addValue(). */
+        const uint8_t addValue(const DATA_TYPES dataType, const uint8_t sensorChannel, const float value)
+        {
+            return flush(field.addValue(dataType, sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point analog input field, see CayenneLPP::addAnalogInput(). */
+        const uint8_t addAnalogInput(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addAnalogInput(sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point analog output field, see CayenneLPP::addAnalogOutput(). */
+        const uint8_t addAnalogOutput(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addAnalogOutput(sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point temperature field, see CayenneLPP::addTemperature(). */
+        const uint8_t addTemperature(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addTemperature(sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point humidity field, see CayenneLPP::addHumidity(). */
+        const uint8_t addHumidity(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addHumidity(sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point accelerometer field, see CayenneLPP::addAccelerometer(). */
+        const uint8_t addAccelerometer(const uint8_t sensorChannel, const FixedPoint x, const FixedPoint y, const FixedPoint z)
+        {
+            return flush(field.addAccelerometer(sensorChannel, x, y, z));
+        }
+
+        /** @brief Streams a fixed-point barometer field, see CayenneLPP::addBarometer(). */
+        const uint8_t addBarometer(const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addBarometer(sensorChannel, value));
+        }
+
+        /** @brief Streams a fixed-point gyroscope field, see CayenneLPP::addGyroscope(). */
+        const uint8_t addGyroscope(const uint8_t sensorChannel, const FixedPoint x, const FixedPoint y, const FixedPoint z)
+        {
+            return flush(field.addGyroscope(sensorChannel, x, y, z));
+        }
+
+        /** @brief Streams a fixed-point GPS location field, see CayenneLPP::addGPSLocation(). */
+        const uint8_t addGPSLocation(const uint8_t sensorChannel, const FixedPoint lat, const FixedPoint lon, const FixedPoint alt)
+        {
+            return flush(field.addGPSLocation(sensorChannel, lat, lon, alt));
+        }
+
+        /** @brief Streams a fixed-point single-value field of any type, see CayenneLPP::addValue(). */
+        const uint8_t addValue(const DATA_TYPES dataType, const uint8_t sensorChannel, const FixedPoint value)
+        {
+            return flush(field.addValue(dataType, sensorChannel, value));
+        }
+
+    private:
+        Print &out;
+        size_t operationalSize;
+        size_t written;
+        CayenneLPP<CAYENNE_MAX_FIELD_SIZE> field;   // holds the field that is being encoded
+
+        /**
+         * @brief Writes the encoded field to the output and clears the field buffer.
+         *
+         * @param fieldSize Size of the encoded field, 0 if encoding failed.
+         * @return uint8_t Returns the new size of the frame, or 0 if the field was not written.
+         */
+        const uint8_t flush(const uint8_t fieldSize)
+        {
+            if (fieldSize == 0 || written + fieldSize > operationalSize)
+            {
+                field.reset();
+                return 0;
+            }
+            out.write(field.getBuffer(), fieldSize);
+            written += fieldSize;
+            field.reset();
+            return written;
+        }
+    }; // End of class CayenneLPPStream.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // CAYENNE_LPP_STREAM_HPP
@@ -0,0 +1,416 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef CAYENNE_LPP_VIEW_HPP
+#define CAYENNE_LPP_VIEW_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CayenneReferences.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Enum class defining the wire formats the decoder understands.
+     */
+    enum class LPP_FORMAT : uint8_t
+    {
+        ENCODER     = 0,    /* As emitted by CayenneLPP.hpp: type, channel, little-endian values, 4 byte GPS values */
+        STANDARD    = 1     /* Standard Cayenne LPP: channel, type, big-endian values, 3 byte GPS values */
+    };
+
+    /**
+     * @brief Returns the size of the data of one field in the given wire format.
+     * @param dataType The data type.
+     * @param format The wire format.
+     * @return The size in bytes, 0 for unknown data types.
+     */
+    const static inline size_t getDataTypeSize(DATA_TYPES dataType, LPP_FORMAT format)
+    {
+        if (format == LPP_FORMAT::STANDARD && dataType == DATA_TYPES::GPS_LOC)
+        {
+            return 9; // 3 bytes per value instead of the 4 bytes the encoder uses
+        }
+        if (format == LPP_FORMAT::STANDARD && dataType == DATA_TYPES::HUM_SENS)
+        {
+            return 1; // 0.5 %RH in one byte instead of 0.1 %RH in two
+        }
+        return getDataTypeSize(dataType);
+    }
+
+    /**
+     * @brief Returns the factor from a raw value in the given wire format to units of the type resolution.
+     *
+     * The standard format sends humidity in steps of 0.5 %RH, the type resolution is 0.1 %RH; every other
+     * type has the same resolution in both formats.
+     *
+     * @param dataType The data type.
+     * @param format The wire format.
+     * @return The factor, 1 if the wire value already is in units of the type resolution.
+     */
+    const static inline uint8_t getDataTypeScale(DATA_TYPES dataType, LPP_FORMAT format)
+    {
+        return (format == LPP_FORMAT::STANDARD && dataType == DATA_TYPES::HUM_SENS) ? 5 : 1;
+    }
+
+    /**
+     * @brief Read-only view on one field of a Cayenne LPP frame.
+     *
+     * The field points into the frame buffer, nothing is copied. Values are decoded on access.
+     */
+    class CayenneField
+    {
+    public:
+        /**
+         * @brief Constructor for an empty field.
+         */
+        CayenneField() : data(nullptr), dataSize(0), sensorChannel(0), dataType(DATA_TYPES::DIG_IN), format(LPP_FORMAT::ENCODER) {}
+
+        /**
+         * @brief Constructor for a field pointing into a frame.
+         *
+         * @param data Pointer to the first data byte (after the header).
+         * @param dataSize Number of data bytes.
+         * @param sensorChannel The channel number of the field.
+         * @param dataType The data type of the field.
+         * @param format The wire format of the frame.
+         */
+        CayenneField(const uint8_t *data, const uint8_t dataSize, const uint8_t sensorChannel, const DATA_TYPES dataType, const LPP_FORMAT format)
+            : data(data), dataSize(dataSize), sensorChannel(sensorChannel), dataType(dataType), format(format) {}
+
+        /**
+         * @brief Gets the channel number.
+         * @return uint8_t The channel number.
+         */
+        uint8_t channel() const
+        {
+            return sensorChannel;
+        }
+
+        /**
+         * @brief Gets the data type.
+         * @return DATA_TYPES The data type.
+         */
+        DATA_TYPES type() const
+        {
+            return dataType;
+        }
+
+        /**
+         * @brief Gets the number of values in this field (1, or 3 for xyz, colour and GPS types).
+         * @return uint8_t The number of values.
+         */
+        uint8_t count() const
+        {
+            return getDataTypeValueCount(dataType);
+        }
+
+        /**
+         * @brief Gets the raw data bytes of this field.
+         * @return const uint8_t* Pointer into the frame buffer.
+         */
+        const uint8_t *bytes() const
+        {
+            return data;
+        }
+
+        /**
+         * @brief Gets the number of data bytes of this field.
+         * @return uint8_t The number of data bytes.
+         */
+        uint8_t size() const
+        {
+            return dataSize;
+        }
+
+        /**
+         * @brief Gets a value as integer in units of the field resolution (e.g. 0.1 °C).
+         *
+         * Values are rescaled to the type resolution, so standard format humidity (0.5 %RH) comes out in 0.1 %RH.
+         * Unsigned 4-byte values above 2147483647 (e.g. a unix time after 2038) do not fit, read them with
+         * unsignedValue().
+         *
+         * @param index The value index, 0 for single value fields, 0..2 for xyz, colour and GPS types.
+         * @return int32_t The scaled value, 0 for an index out of range.
+         */
+        int32_t scaledValue(const uint8_t index = 0) const
+        {
+            return static_cast<int32_t>(rawValue(index));
+        }
+
+        /**
+         * @brief Gets a value of an unsigned type as integer in units of the field resolution.
+         *
+         * Covers the full range of the unsigned 4-byte types. For signed types use scaledValue().
+         *
+         * @param index The value index, 0 for single value fields, 0..2 for colour types.
+         * @return uint32_t The scaled value, 0 for an index out of range.
+         */
+        uint32_t unsignedValue(const uint8_t index = 0) const
+        {
+            return rawValue(index);
+        }
+
+        /**
+         * @brief Gets the number of scaled units per unit of the value (e.g. 10 for 0.1 °C).
+         *
+         * @param index The value index; the GPS altitude has a different resolution than latitude and longitude.
+         * @return int32_t The resolution divisor, 1 for unscaled types.
+         */
+        int32_t resolution(const uint8_t index = 0) const
+        {
+            const int32_t res = FLOATING_DATA_RESOLUTION(dataType);
+            if (res == 0)
+            {
+                return 1;
+            }
+            if (dataType == DATA_TYPES::GPS_LOC && index == 2)
+            {
+                return res / 100;
+            }
+            return res;
+        }
+
+        /**
+         * @brief Gets a value converted to its unit (e.g. °C). Uses float, prefer scaledValue() on AVR.
+         *
+         * @param index The value index.
+         * @return float The value.
+         */
+        float value(const uint8_t index = 0) const
+        {
+            const float scaled = isDataTypeSigned(dataType) ? static_cast<float>(scaledValue(index)) : static_cast<float>(unsignedValue(index));
+            return scaled / resolution(index);
+        }
+
+    private:
+        const uint8_t *data;
+        uint8_t dataSize;
+        uint8_t sensorChannel;
+        DATA_TYPES dataType;
+        LPP_FORMAT format;
+
+        /**
+         * @brief Assembles a value in units of the field resolution, sign extended for signed types.
+         */
+        uint32_t rawValue(const uint8_t index) const
+        {
+            if (index >= count())
+            {
+                return 0;
+            }
+            const uint8_t width = dataSize / count();
+            const uint8_t *p = data + index * width;
+            uint32_t raw = 0;
+            for (uint8_t i = 0; i < width; i++)
+            {
+                const uint8_t shift = (format == LPP_FORMAT::STANDARD) ? (width - 1 - i) * 8 : i * 8;
+                raw |= static_cast<uint32_t>(p[i]) << shift;
+            }
+            if (isDataTypeSigned(dataType) && width < 4 && (raw & (1UL << (width * 8 - 1))))
+            {
+                raw |= ~((1UL << (width * 8)) - 1); // sign extend
+            }
+            return raw * static_cast<uint32_t>(getDataTypeScale(dataType, format));
+        }
+    };
+
+    /**
+     * @brief Zero-copy decoder for Cayenne LPP frames.
+     *
+     * Wraps a const buffer and iterates over its fields without copying or allocating:
+     *
+     *     PAYLOAD_ENCODER::CayenneLPPView view(payload, size);
+     *     for (const PAYLOAD_ENCODER::CayenneField &field : view) { ... }
+     *
+     * Field sizes are checked with getDataTypeSize(). Iteration stops at the first unknown type or
+     * truncated field; use validate() to find out whether the whole frame was consumed.
+     */
+    class CayenneLPPView
+    {
+    public:
+        /**
+         * @brief Forward iterator over the fields of a frame.
+         */
+        class Iterator
+        {
+        public:
+            /**
+             * @brief Constructor for an iterator at the given offset.
+             *
+             * @param view The view to iterate over.
+             * @param offset Byte offset of the field header; size of the frame for the end iterator.
+             */
+            Iterator(const CayenneLPPView *view, const size_t offset) : view(view), offset(offset)
+            {
+                load();
+            }
+
+            const CayenneField &operator*() const
+            {
+                return field;
+            }
+
+            const CayenneField *operator->() const
+            {
+                return &field;
+            }
+
+            Iterator &operator++()
+            {
+                offset += 2 + field.size();
+                load();
+                return *this;
+            }
+
+            bool operator==(const Iterator &other) const
+            {
+                return offset == other.offset;
+            }
+
+            bool operator!=(const Iterator &other) const
+            {
+                return offset != other.offset;
+            }
+
+        private:
+            const CayenneLPPView *view;
+            size_t offset;
+            CayenneField field;
+
+            // Decode the field at offset, or move to the end if it is invalid.
+            void load()
+            {
+                if (offset < view->size && view->parseAt(offset, field) != ERROR_TYPES::LPP_ERROR_OK)
+                {
+                    offset = view->size;
+                }
+            }
+        };
+
+        /**
+         * @brief Constructor for CayenneLPPView.
+         *
+         * @param buffer The frame to decode. Must stay valid while the view is used.
+         * @param size The size of the frame in bytes.
+         * @param format The wire format of the frame.
+         */
+        CayenneLPPView(const uint8_t *buffer, const size_t size, const LPP_FORMAT format = LPP_FORMAT::ENCODER)
+            : buffer(buffer), size(buffer ? size : 0), format(format) {}
+
+        /**
+         * @brief Returns an iterator to the first field.
+         * @return Iterator The begin iterator.
+         */
+        Iterator begin() const
+        {
+            return Iterator(this, 0);
+        }
+
+        /**
+         * @brief Returns the end iterator.
+         * @return Iterator The end iterator.
+         */
+        Iterator end() const
+        {
+            return Iterator(this, size);
+        }
+
+        /**
+         * @brief Checks the whole frame.
+         *
+         * @return ERROR_TYPES LPP_ERROR_OK if every byte belongs to a valid field, LPP_ERROR_UNKOWN_TYPE
+         *         at the first unknown data type and LPP_ERROR_OVERFLOW if a field runs past the end.
+         */
+        ERROR_TYPES validate() const
+        {
+            CayenneField field;
+            size_t offset = 0;
+            while (offset < size)
+            {
+                const ERROR_TYPES error = parseAt(offset, field);
+                if (error != ERROR_TYPES::LPP_ERROR_OK)
+                {
+                    return error;
+                }
+                offset += 2 + field.size();
+            }
+            return ERROR_TYPES::LPP_ERROR_OK;
+        }
+
+        /**
+         * @brief Counts the valid fields in the frame.
+         * @return size_t The number of fields.
+         */
+        size_t count() const
+        {
+            size_t n = 0;
+            for (Iterator it = begin(); it != end(); ++it)
+            {
+                n++;
+            }
+            return n;
+        }
+
+        /**
+         * @brief Finds the first field with the given channel and data type.
+         *
+         * @param sensorChannel The channel number to look for.
+         * @param dataType The data type to look for.
+         * @param field Set to the field when found.
+         * @return bool True if the field was found.
+         */
+        bool find(const uint8_t sensorChannel, const DATA_TYPES dataType, CayenneField &field) const
+        {
+            for (Iterator it = begin(); it != end(); ++it)
+            {
+                if (it->channel() == sensorChannel && it->type() == dataType)
+                {
+                    field = *it;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        const uint8_t *buffer;
+        size_t size;
+        LPP_FORMAT format;
+
+        /**
+         * @brief Decodes the field header at the given offset.
+         *
+         * @param offset Byte offset of the field header.
+         * @param field Set to the field when it is valid.
+         * @return ERROR_TYPES LPP_ERROR_OK, LPP_ERROR_UNKOWN_TYPE or LPP_ERROR_OVERFLOW.
+         */
+        ERROR_TYPES parseAt(const size_t offset, CayenneField &field) const
+        {
+            if (offset + 2 > size)
+            {
+                return ERROR_TYPES::LPP_ERROR_OVERFLOW;
+            }
+            const uint8_t first = buffer[offset];
+            const uint8_t second = buffer[offset + 1];
+            const uint8_t sensorChannel = (format == LPP_FORMAT::STANDARD) ? first : second;
+            const DATA_TYPES dataType = static_cast<DATA_TYPES>((format == LPP_FORMAT::STANDARD) ? second : first);
+            const size_t dataSize = getDataTypeSize(dataType, format);
+            if (dataSize == 0)
+            {
+                return ERROR_TYPES::LPP_ERROR_UNKOWN_TYPE;
+            }
+            if (offset + 2 + dataSize > size)
+            {
+                return ERROR_TYPES::LPP_ERROR_OVERFLOW;
+            }
+            field = CayenneField(&buffer[offset + 2], static_cast<uint8_t>(dataSize), sensorChannel, dataType, format);
+            return ERROR_TYPES::LPP_ERROR_OK;
+        }
+    };
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // CAYENNE_LPP_VIEW_HPP
@@ -10,6 +10,10 @@
 #define CAYENNE_REFERENCES_HPP
 
 #include <stdint.h>
+#include <stddef.h>
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
 
 namespace PAYLOAD_ENCODER
 {
@@ -22,14 +26,28 @@ namespace PAYLOAD_ENCODER
         DIG_OUT     = 1,    /* DITIAL OUTPUT */
         ANL_IN      = 2,    /* ANALOG INPUT */
         ANL_OUT     = 3,    /* ANALOG OUTPUT */
+        GEN_SENS    = 100,  /* GENERIC SENSOR */
         ILLUM_SENS  = 101,  /* ILLUMINATION SENSOR */
         PRSNC_SENS  = 102,  /* PRESCENCE SENSOR */
         TEMP_SENS   = 103,  /* TEMPERATURE SENSOR */
         HUM_SENS    = 104,  /* HUMIDITY SENSOR */
         ACCRM_SENS  = 113,  /* ACCELEROMETER */
         BARO_SENS   = 115,  /* BAROMETER */
+        VOLT_SENS   = 116,  /* VOLTAGE */
+        CURR_SENS   = 117,  /* CURRENT */
+        FREQ_SENS   = 118,  /* FREQUENCY */
+        PERC_SENS   = 120,  /* PERCENTAGE */
+        ALT_SENS    = 121,  /* ALTITUDE */
+        CONC_SENS   = 125,  /* CONCENTRATION */
+        PWR_SENS    = 128,  /* POWER */
+        DIST_SENS   = 130,  /* DISTANCE */
+        ENRG_SENS   = 131,  /* ENERGY */
+        DIR_SENS    = 132,  /* DIRECTION */
+        UNIX_TIME   = 133,  /* UNIX TIME */
         GYRO_SENS   = 134,  /* GYROMETER */
-        GPS_LOC     = 136   /* GPS LOCATION METER */
+        COLOUR      = 135,  /* COLOUR */
+        GPS_LOC     = 136,  /* GPS LOCATION METER */
+        SWITCH      = 142   /* SWITCH */
     };
 
     /**
@@ -41,94 +59,174 @@ namespace PAYLOAD_ENCODER
         DIG_OUT     = 1,    /* 1 bit resolution */
         ANL_IN      = 2,    /* 0.01 Signed */
         ANL_OUT     = 2,    /* 0.01 Signed */
+        GEN_SENS    = 4,    /* 1 Unsigned */
         ILLUM_SENS  = 2,    /* 1 Lux Unsigned MSB */
         PRSNC_SENS  = 1,    /* 1 bit resolution */
         TEMP_SENS   = 2,    /* 0.1 °C Signed MSB */
         HUM_SENS    = 2,    /* 0.1 % Unsigned */
         ACCRM_SENS  = 6,    /* 0.001 G Signed MSB per axis */
         BARO_SENS   = 2,    /* 0.1 hPa Unsigned MSB */
+        VOLT_SENS   = 2,    /* 0.01 V Unsigned */
+        CURR_SENS   = 2,    /* 0.001 A Unsigned */
+        FREQ_SENS   = 4,    /* 1 Hz Unsigned */
+        PERC_SENS   = 1,    /* 1 % Unsigned (0..100) */
+        ALT_SENS    = 2,    /* 1 m Signed */
+        CONC_SENS   = 2,    /* 1 ppm Unsigned */
+        PWR_SENS    = 2,    /* 1 W Unsigned */
+        DIST_SENS   = 4,    /* 0.001 m Unsigned */
+        ENRG_SENS   = 4,    /* 0.001 kWh Unsigned */
+        DIR_SENS    = 2,    /* 1 ° Unsigned */
+        UNIX_TIME   = 4,    /* 1 s Unsigned */
         GYRO_SENS   = 6,    /* 0.01 °/s Signed MSB per axis */
-        GPS_LOC     = 12    /* Latitude  : 0.0001° Signed MSB
+        COLOUR      = 3,    /* 1 byte per R, G and B */
+        GPS_LOC     = 12,   /* Latitude  : 0.0001° Signed MSB
                              * Longitude : 0.0001° Signed MSB
                              * Altitude  : 0.01 meter Signed MSB */
+        SWITCH      = 1     /* 0 or 1 */
     };
-    
+
+#if defined(__AVR__)
+#define LPP_TABLE_ATTRIBUTE PROGMEM
+#define LPP_READ_TABLE_WORD(address) pgm_read_word(address)
+#else
+#define LPP_TABLE_ATTRIBUTE
+#define LPP_READ_TABLE_WORD(address) (*(address))
+#endif
+
+    /**
+     * @brief Packs the metadata of one data type into 16 bits.
+     *
+     * Bits 0..3 hold the size in bytes, bits 4..6 the resolution as power of ten, bit 7 the signedness
+     * and bits 8..9 the number of values. An all-zero entry marks an unknown type.
+     *
+     * @param size Size of the data in bytes.
+     * @param decimals Resolution as power of ten, e.g. 1 for 0.1 °C.
+     * @param isSigned True for two's complement values.
+     * @param values Number of values, 1 or 3.
+     * @return uint16_t The packed metadata.
+     */
+    constexpr uint16_t makeDataTypeInfo(const DATA_TYPES_SIZES size, const uint8_t decimals, const bool isSigned, const uint8_t values)
+    {
+        return static_cast<uint16_t>(static_cast<uint16_t>(size) | (decimals << 4) | (isSigned ? 0x80 : 0) | (values << 8));
+    }
+
+    /**
+     * @brief Number of rows in DATA_TYPE_INFO.
+     */
+    static const uint8_t DATA_TYPE_INFO_ROWS = 47;
+
+    /**
+     * @brief Maps a data type to its row in DATA_TYPE_INFO: 0..3 map to themselves, 100..142 to 4..46.
+     * @param dataType The data type.
+     * @return uint8_t The row, or DATA_TYPE_INFO_ROWS for types outside both ranges.
+     */
+    constexpr uint8_t getDataTypeRow(const DATA_TYPES dataType)
+    {
+        return static_cast<uint8_t>(dataType) < 4 ? static_cast<uint8_t>(dataType)
+             : (static_cast<uint8_t>(dataType) >= 100 && static_cast<uint8_t>(dataType) <= 142) ? static_cast<uint8_t>(dataType) - 96
+             : DATA_TYPE_INFO_ROWS;
+    }
+
+    /**
+     * @brief Metadata of every data type, see makeDataTypeInfo(). Lives in flash on AVR.
+     *
+     * Adding a type only needs a row here (and a DATA_TYPES entry); all lookups and the encoder, the
+     * decoders and the time series use this table.
+     */
+    static const uint16_t DATA_TYPE_INFO[DATA_TYPE_INFO_ROWS] LPP_TABLE_ATTRIBUTE =
+    {
+        makeDataTypeInfo(DATA_TYPES_SIZES::DIG_IN, 0, false, 1),       /*   0 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::DIG_OUT, 0, false, 1),      /*   1 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ANL_IN, 2, true, 1),        /*   2 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ANL_OUT, 2, true, 1),       /*   3 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::GEN_SENS, 0, false, 1),     /* 100 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ILLUM_SENS, 0, false, 1),   /* 101 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::PRSNC_SENS, 0, false, 1),   /* 102 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::TEMP_SENS, 1, true, 1),     /* 103 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::HUM_SENS, 1, false, 1),     /* 104 */
+        0, 0, 0, 0, 0, 0, 0, 0,                                         /* 105..112 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ACCRM_SENS, 3, true, 3),    /* 113 */
+        0,                                                              /* 114 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::BARO_SENS, 1, false, 1),    /* 115 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::VOLT_SENS, 2, false, 1),    /* 116 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::CURR_SENS, 3, false, 1),    /* 117 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::FREQ_SENS, 0, false, 1),    /* 118 */
+        0,                                                              /* 119 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::PERC_SENS, 0, false, 1),    /* 120 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ALT_SENS, 0, true, 1),      /* 121 */
+        0, 0, 0,                                                        /* 122..124 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::CONC_SENS, 0, false, 1),    /* 125 */
+        0, 0,                                                           /* 126..127 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::PWR_SENS, 0, false, 1),     /* 128 */
+        0,                                                              /* 129 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::DIST_SENS, 3, false, 1),    /* 130 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::ENRG_SENS, 3, false, 1),    /* 131 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::DIR_SENS, 0, false, 1),     /* 132 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::UNIX_TIME, 0, false, 1),    /* 133 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::GYRO_SENS, 2, true, 3),     /* 134 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::COLOUR, 0, false, 3),       /* 135 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::GPS_LOC, 4, true, 3),       /* 136 */
+        0, 0, 0, 0, 0,                                                  /* 137..141 */
+        makeDataTypeInfo(DATA_TYPES_SIZES::SWITCH, 0, false, 1)        /* 142 */
+    };
+
+    /**
+     * @brief Powers of ten for the resolution field of DATA_TYPE_INFO.
+     */
+    static const uint16_t DATA_TYPE_RESOLUTIONS[5] LPP_TABLE_ATTRIBUTE = {1, 10, 100, 1000, 10000};
+
+    /**
+     * @brief Looks up the packed metadata of a data type in O(1).
+     * @param dataType The data type.
+     * @return uint16_t The metadata, 0 for unknown types.
+     */
+    static inline uint16_t getDataTypeInfo(DATA_TYPES dataType)
+    {
+        const uint8_t row = getDataTypeRow(dataType);
+        return row < DATA_TYPE_INFO_ROWS ? LPP_READ_TABLE_WORD(&DATA_TYPE_INFO[row]) : 0;
+    }
+
     /**
      * @brief Function to get the resolution for floating point data types.
      * @param dataType The data type.
-     * @return The resolution of the data type.
+     * @return The number of scaled units per unit (1 for unscaled types), 0 for unknown types.
+     *         For GPS this is the latitude and longitude resolution; the altitude uses 1/100 of it.
      */
     const static inline int16_t FLOATING_DATA_RESOLUTION(DATA_TYPES dataType)
     {
-        switch (dataType)
-        {
-        case DATA_TYPES::DIG_IN:
-            break;
-        case DATA_TYPES::DIG_OUT:
-            break;
-        case DATA_TYPES::ANL_IN:    
-            return 100;                 // 0.01 Signed Resolution.
-        case DATA_TYPES::ANL_OUT:
-            return 100;                 // 0.01 Signed Resolution.
-        case DATA_TYPES::ILLUM_SENS:
-            break;
-        case DATA_TYPES::PRSNC_SENS:
-            break;
-        case DATA_TYPES::TEMP_SENS:
-            return 10;                  // 0.1 °C Signed MSB Resolution.
-        case DATA_TYPES::HUM_SENS:
-            return 10;                  // 0.1 % Unsigned Resolution                       
-        case DATA_TYPES::ACCRM_SENS:
-            return 1000;                // 0.001 G Signed MSB per axis
-        case DATA_TYPES::BARO_SENS:
-            return 10;                  // 0.1 hPa Unsigned MSB
-        case DATA_TYPES::GYRO_SENS:
-            return 100;                 // 0.01 °/s Signed MSB per axis
-        case DATA_TYPES::GPS_LOC:
-            return 10000;               // 0.0001° Signed MSB for Lat- & Longitude
-        default:
-            return 0;
-        }
-        return 0;
+        const uint16_t info = getDataTypeInfo(dataType);
+        return info ? static_cast<int16_t>(LPP_READ_TABLE_WORD(&DATA_TYPE_RESOLUTIONS[(info >> 4) & 0x07])) : 0;
     }
 
     /**
      * @brief Function to create a mapping between data types reference and respective size in bytes.
      * @param dataType The data type.
-     * @return The size of the data type in bytes.
+     * @return The size of the data type in bytes, 0 for unknown types.
      */
     const static inline size_t getDataTypeSize(DATA_TYPES dataType)
     {
-        switch (dataType)
-        {
-        case DATA_TYPES::DIG_IN:
-            return static_cast<size_t>(DATA_TYPES_SIZES::DIG_IN);
-        case DATA_TYPES::DIG_OUT:
-            return static_cast<size_t>(DATA_TYPES_SIZES::DIG_OUT);
-        case DATA_TYPES::ANL_IN:
-            return static_cast<size_t>(DATA_TYPES_SIZES::ANL_IN);
-        case DATA_TYPES::ANL_OUT:
-            return static_cast<size_t>(DATA_TYPES_SIZES::ANL_OUT);
-        case DATA_TYPES::ILLUM_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::ILLUM_SENS);
-        case DATA_TYPES::PRSNC_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::PRSNC_SENS);
-        case DATA_TYPES::TEMP_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::TEMP_SENS);
-        case DATA_TYPES::HUM_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::HUM_SENS);
-        case DATA_TYPES::ACCRM_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::ACCRM_SENS);
-        case DATA_TYPES::BARO_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::BARO_SENS);
-        case DATA_TYPES::GYRO_SENS:
-            return static_cast<size_t>(DATA_TYPES_SIZES::GYRO_SENS);
-        case DATA_TYPES::GPS_LOC:
-            return static_cast<size_t>(DATA_TYPES_SIZES::GPS_LOC);
-        default:
-            return 0;
-        }
-        return 0;
+        return getDataTypeInfo(dataType) & 0x0F;
+    }
+
+    /**
+     * @brief Returns the number of values a data type carries (3 for the xyz, colour and GPS types, otherwise 1).
+     * @param dataType The data type.
+     * @return The number of values in one field.
+     */
+    const static inline uint8_t getDataTypeValueCount(DATA_TYPES dataType)
+    {
+        const uint8_t values = (getDataTypeInfo(dataType) >> 8) & 0x03;
+        return values ? values : 1;
+    }
+
+    /**
+     * @brief Returns whether the values of a data type are two's complement signed.
+     * @param dataType The data type.
+     * @return True for signed data types.
+     */
+    const static inline bool isDataTypeSigned(DATA_TYPES dataType)
+    {
+        return (getDataTypeInfo(dataType) & 0x80) != 0;
     }
 
     /**
@@ -136,9 +234,9 @@ namespace PAYLOAD_ENCODER
      */
     enum class ERROR_TYPES : uint8_t
     {
-        LPP_ERROR_OVERFLOW      = 0,    /**< No error */
-        LPP_ERROR_UNKOWN_TYPE   = 1,    /**< Buffer overflow */
-        LPP_ERROR_OK            = 2     /**< Unknown data type */
+        LPP_ERROR_OVERFLOW      = 0,    /**< Buffer overflow */
+        LPP_ERROR_UNKOWN_TYPE   = 1,    /**< Unknown data type */
+        LPP_ERROR_OK            = 2     /**< No error */
     };
 
 } // End of PAYLOAD_ENCODER Namespace.
@@ -0,0 +1,468 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef DELTA_PAYLOAD_HPP
+#define DELTA_PAYLOAD_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CayenneLPP.hpp"
+#include "CayenneLPPView.hpp"
+#include "TimeSeries.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Bit in the first byte that marks a delta frame; keyframes have it cleared.
+     */
+    static const uint8_t DELTA_FRAME_FLAG = 0x80;
+
+    /**
+     * @brief Mask of the sequence number in the first byte.
+     */
+    static const uint8_t DELTA_SEQUENCE_MASK = 0x7F;
+
+    /**
+     * @brief Result of decoding a keyframe or delta frame.
+     */
+    enum class DELTA_RESULTS : uint8_t
+    {
+        DELTA_KEYFRAME              = 0,    /**< A keyframe was received, the frame is complete. */
+        DELTA_APPLIED               = 1,    /**< A delta frame was applied to the previous frame. */
+        DELTA_WAITING_FOR_KEYFRAME  = 2,    /**< A frame was lost; deltas are dropped until the next keyframe. */
+        DELTA_MALFORMED             = 3     /**< The frame could not be decoded; waiting for the next keyframe. */
+    };
+
+    /**
+     * @brief Returns whether two LPP frames have the same fields in the same order.
+     *
+     * @param a The first frame.
+     * @param aSize Size of the first frame.
+     * @param b The second frame.
+     * @param bSize Size of the second frame.
+     * @return bool True if type and channel of every field match.
+     */
+    static inline bool isSameLppLayout(const uint8_t *a, const size_t aSize, const uint8_t *b, const size_t bSize)
+    {
+        if (aSize != bSize)
+        {
+            return false;
+        }
+        const CayenneLPPView first(a, aSize);
+        const CayenneLPPView second(b, bSize);
+        if (first.validate() != ERROR_TYPES::LPP_ERROR_OK || second.validate() != ERROR_TYPES::LPP_ERROR_OK)
+        {
+            return false;
+        }
+        CayenneLPPView::Iterator other = second.begin();
+        for (const CayenneField &field : first)
+        {
+            if (field.type() != other->type() || field.channel() != other->channel())
+            {
+                return false;
+            }
+            ++other;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Template class for keyframe/delta encoding on top of CayenneLPP.
+     *
+     * Fields are added to frame() as usual. encode() then produces either a keyframe:
+     *
+     *     [sequence] CayenneLPP fields
+     *
+     * or, when the fields are the same as in the previous frame, a delta frame:
+     *
+     *     [0x80 | sequence][bitmap] zigzag varint delta of every changed value
+     *
+     * The bitmap has one bit per value (three for xyz and GPS fields), LSB first, set when the
+     * quantised value differs from the previous frame. A keyframe is sent every keyframeInterval
+     * frames, whenever the fields change and whenever a delta frame would not be smaller, so a
+     * receiver that lost a frame is back in sync after at most keyframeInterval uplinks. Use a
+     * separate LoRaWAN port for these frames and DeltaDecoder on the receiving side.
+     *
+     * @tparam MaxSize Maximum size of the CayenneLPP frame.
+     */
+    template <size_t MaxSize>
+    class DeltaEncoder
+    {
+    public:
+        /**
+         * @brief Constructor for DeltaEncoder.
+         *
+         * @param size Size of the encoded frame, normally the max payload of the current data rate.
+         * @param keyframeInterval Number of frames per keyframe, 1 sends keyframes only.
+         */
+        DeltaEncoder(const uint8_t size, const uint8_t keyframeInterval)
+            : lpp(size > 0 ? size - 1 : 0), operationalSize(size > MaxSize + 1 ? MaxSize + 1 : size),
+              keyframeInterval(keyframeInterval ? keyframeInterval : 1), sequence(0), sinceKeyframe(0),
+              referenceSize(0), hasReference(false), keyframe(false), currentIndex(0) {}
+
+        /**
+         * @brief Returns the CayenneLPP frame the fields of the next uplink are added to.
+         *
+         * Call frame().reset() before adding the fields of a new uplink.
+         *
+         * @return CayenneLPP<MaxSize>& The frame.
+         */
+        CayenneLPP<MaxSize> &frame()
+        {
+            return lpp;
+        }
+
+        /**
+         * @brief Changes the operational size, e.g. to TheThingsNetwork::getMaxPayload() before each frame.
+         *
+         * @param size New size of the encoded frame.
+         */
+        void setOperationalSize(const uint8_t size)
+        {
+            operationalSize = size > MaxSize + 1 ? MaxSize + 1 : size;
+            lpp.setOperationalSize(size > 0 ? size - 1 : 0);
+        }
+
+        /**
+         * @brief Makes the next encode() produce a keyframe, e.g. after a rejoin or on request of the backend.
+         */
+        void forceKeyframe()
+        {
+            hasReference = false;
+        }
+
+        /**
+         * @brief Encodes the fields of frame() as keyframe or delta frame.
+         *
+         * @return uint8_t Returns the size of the encoded frame, or 0 if it does not fit in the operational size.
+         */
+        const uint8_t encode()
+        {
+            const uint8_t next = (sequence + 1) & DELTA_SEQUENCE_MASK;
+            keyframe = !hasReference || sinceKeyframe + 1 >= keyframeInterval
+                || !isSameLppLayout(reference, referenceSize, lpp.getBuffer(), lpp.getSize());
+            if (!keyframe)
+            {
+                currentIndex = encodeDelta(next);
+                keyframe = currentIndex == 0 || currentIndex >= lpp.getSize() + 1;
+            }
+            if (keyframe)
+            {
+                if (lpp.getSize() + 1 > operationalSize)
+                {
+                    currentIndex = 0;
+                    return 0;
+                }
+                buffer[0] = next;
+                lpp.copy(buffer + 1);
+                currentIndex = lpp.getSize() + 1;
+                sinceKeyframe = 0;
+            }
+            else
+            {
+                sinceKeyframe++;
+            }
+            sequence = next;
+            referenceSize = lpp.copy(reference);
+            hasReference = true;
+            return currentIndex;
+        }
+
+        /**
+         * @brief Returns whether the last encode() produced a keyframe.
+         * @return bool True for a keyframe.
+         */
+        bool isKeyframe() const
+        {
+            return keyframe;
+        }
+
+        /**
+         * @brief Gets the size of the encoded frame.
+         * @return size_t Number of used bytes.
+         */
+        size_t getSize(void) const
+        {
+            return currentIndex;
+        }
+
+        /**
+         * @brief Returns the encoded frame.
+         * @return const uint8_t* Pointer to the buffer.
+         */
+        const uint8_t *getBuffer(void) const
+        {
+            return buffer;
+        }
+
+    private:
+        CayenneLPP<MaxSize> lpp;
+        uint8_t reference[MaxSize];     // fields of the previous frame
+        uint8_t buffer[MaxSize + 1];    // encoded frame
+        size_t operationalSize;
+        uint8_t keyframeInterval;
+        uint8_t sequence;
+        uint8_t sinceKeyframe;
+        uint8_t referenceSize;
+        bool hasReference;
+        bool keyframe;
+        size_t currentIndex;
+
+        /**
+         * @brief Encodes the changes against the reference frame. The layouts must be equal.
+         *
+         * @param next The sequence number of the frame.
+         * @return size_t Size of the delta frame, or 0 if it does not fit.
+         */
+        size_t encodeDelta(const uint8_t next)
+        {
+            const CayenneLPPView previous(reference, referenceSize);
+            const CayenneLPPView current(lpp.getBuffer(), lpp.getSize());
+            size_t values = 0;
+            for (const CayenneField &field : current)
+            {
+                values += field.count();
+            }
+            const size_t bitmapSize = (values + 7) / 8;
+            if (1 + bitmapSize > operationalSize)
+            {
+                return 0;
+            }
+            buffer[0] = DELTA_FRAME_FLAG | next;
+            for (size_t i = 1; i <= bitmapSize; i++)
+            {
+                buffer[i] = 0;
+            }
+            size_t index = 1 + bitmapSize;
+            size_t bit = 0;
+            CayenneLPPView::Iterator old = previous.begin();
+            for (const CayenneField &field : current)
+            {
+                for (uint8_t i = 0; i < field.count(); i++, bit++)
+                {
+                    const uint32_t delta = zigzagEncode(field.scaledValue(i) - old->scaledValue(i));
+                    if (delta == 0)
+                    {
+                        continue;
+                    }
+                    if (index + getVarintSize(delta) > operationalSize)
+                    {
+                        return 0;
+                    }
+                    buffer[1 + bit / 8] |= 1 << (bit % 8);
+                    index = appendVarint(index, delta);
+                }
+                ++old;
+            }
+            return index;
+        }
+
+        /**
+         * @brief Writes a LEB128 varint. Capacity must be checked by the caller.
+         *
+         * @param index Write position.
+         * @param value The value to append.
+         * @return size_t The position after the varint.
+         */
+        size_t appendVarint(size_t index, uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer[index++] = static_cast<uint8_t>(value) | 0x80;
+                value >>= 7;
+            }
+            buffer[index++] = static_cast<uint8_t>(value);
+            return index;
+        }
+    }; // End of class DeltaEncoder.
+
+    /**
+     * @brief Template class that turns keyframes and delta frames of one device back into CayenneLPP frames.
+     *
+     * Keeps the last complete frame of the device. A gap in the sequence numbers means a frame was
+     * lost, after which delta frames are dropped until the next keyframe.
+     *
+     * @tparam MaxSize Maximum size of the CayenneLPP frame.
+     */
+    template <size_t MaxSize>
+    class DeltaDecoder
+    {
+    public:
+        /**
+         * @brief Constructor for DeltaDecoder.
+         */
+        DeltaDecoder() : size(0), sequence(0), synchronised(false) {}
+
+        /**
+         * @brief Decodes a keyframe or delta frame.
+         *
+         * @param payload The received frame.
+         * @param payloadSize Size of the received frame.
+         * @return DELTA_RESULTS DELTA_KEYFRAME or DELTA_APPLIED when getBuffer() holds the complete frame.
+         */
+        DELTA_RESULTS decode(const uint8_t *payload, const size_t payloadSize)
+        {
+            if (!payload || payloadSize == 0)
+            {
+                synchronised = false;
+                return DELTA_RESULTS::DELTA_MALFORMED;
+            }
+            const uint8_t received = payload[0] & DELTA_SEQUENCE_MASK;
+            if (!(payload[0] & DELTA_FRAME_FLAG))
+            {
+                const CayenneLPPView view(payload + 1, payloadSize - 1);
+                if (payloadSize - 1 > MaxSize || view.validate() != ERROR_TYPES::LPP_ERROR_OK)
+                {
+                    synchronised = false;
+                    return DELTA_RESULTS::DELTA_MALFORMED;
+                }
+                for (size_t i = 1; i < payloadSize; i++)
+                {
+                    frame[i - 1] = payload[i];
+                }
+                size = payloadSize - 1;
+                sequence = received;
+                synchronised = true;
+                return DELTA_RESULTS::DELTA_KEYFRAME;
+            }
+            if (!synchronised || received != ((sequence + 1) & DELTA_SEQUENCE_MASK))
+            {
+                synchronised = false;
+                return DELTA_RESULTS::DELTA_WAITING_FOR_KEYFRAME;
+            }
+            if (!applyDelta(payload, payloadSize))
+            {
+                synchronised = false;
+                return DELTA_RESULTS::DELTA_MALFORMED;
+            }
+            sequence = received;
+            return DELTA_RESULTS::DELTA_APPLIED;
+        }
+
+        /**
+         * @brief Returns whether the decoder has a current frame to apply deltas to.
+         * @return bool False after a lost or malformed frame until the next keyframe.
+         */
+        bool isSynchronised() const
+        {
+            return synchronised;
+        }
+
+        /**
+         * @brief Gets the size of the last complete frame.
+         * @return size_t Number of used bytes.
+         */
+        size_t getSize(void) const
+        {
+            return size;
+        }
+
+        /**
+         * @brief Returns the last complete frame in CayenneLPP format, decode it with CayenneLPPView.
+         * @return const uint8_t* Pointer to the frame.
+         */
+        const uint8_t *getBuffer(void) const
+        {
+            return frame;
+        }
+
+    private:
+        uint8_t frame[MaxSize];
+        uint8_t updated[MaxSize];
+        size_t size;
+        uint8_t sequence;
+        bool synchronised;
+
+        /**
+         * @brief Applies a delta frame to the current frame; the frame is only changed when the whole delta is valid.
+         *
+         * @param payload The delta frame.
+         * @param payloadSize Size of the delta frame.
+         * @return bool False for a malformed delta frame.
+         */
+        bool applyDelta(const uint8_t *payload, const size_t payloadSize)
+        {
+            const CayenneLPPView view(frame, size);
+            size_t values = 0;
+            for (const CayenneField &field : view)
+            {
+                values += field.count();
+            }
+            const size_t bitmapSize = (values + 7) / 8;
+            if (1 + bitmapSize > payloadSize)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < size; i++)
+            {
+                updated[i] = frame[i];
+            }
+            size_t offset = 1 + bitmapSize;
+            size_t bit = 0;
+            for (const CayenneField &field : view)
+            {
+                const uint8_t width = field.size() / field.count();
+                for (uint8_t i = 0; i < field.count(); i++, bit++)
+                {
+                    if (!(payload[1 + bit / 8] & (1 << (bit % 8))))
+                    {
+                        continue;
+                    }
+                    uint32_t delta;
+                    if (!readVarint(payload, payloadSize, offset, delta))
+                    {
+                        return false;
+                    }
+                    const uint32_t value = static_cast<uint32_t>(field.scaledValue(i) + zigzagDecode(delta));
+                    uint8_t *target = updated + (field.bytes() - frame) + i * width;
+                    for (uint8_t byte = 0; byte < width; byte++)
+                    {
+                        target[byte] = static_cast<uint8_t>(value >> (8 * byte));
+                    }
+                }
+            }
+            if (offset != payloadSize)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < size; i++)
+            {
+                frame[i] = updated[i];
+            }
+            return true;
+        }
+
+        /**
+         * @brief Reads a LEB128 varint.
+         *
+         * @param payload The frame.
+         * @param payloadSize Size of the frame.
+         * @param offset Read position, advanced past the varint.
+         * @param value Receives the value.
+         * @return bool False if the varint runs past the end of the frame or is longer than 5 bytes.
+         */
+        static bool readVarint(const uint8_t *payload, const size_t payloadSize, size_t &offset, uint32_t &value)
+        {
+            value = 0;
+            for (uint8_t shift = 0; shift < 35; shift += 7)
+            {
+                if (offset >= payloadSize)
+                {
+                    return false;
+                }
+                const uint8_t current = payload[offset++];
+                value |= static_cast<uint32_t>(current & 0x7F) << shift;
+                if (!(current & 0x80))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }; // End of class DeltaDecoder.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // DELTA_PAYLOAD_HPP
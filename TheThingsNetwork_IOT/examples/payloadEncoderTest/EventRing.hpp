@@ -0,0 +1,146 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef EVENT_RING_HPP
+#define EVENT_RING_HPP
+
+#include <stdint.h>
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+namespace PAYLOAD_ENCODER
+{
+#if defined(__AVR__)
+    /**
+     * @brief Ring index; single byte loads and stores are atomic on AVR.
+     */
+    typedef volatile uint8_t EventRingIndex;
+
+    inline uint8_t loadIndex(const EventRingIndex &index)
+    {
+        const uint8_t value = index;
+        __asm__ __volatile__("" ::: "memory"); // read the slot after the index
+        return value;
+    }
+
+    inline void storeIndex(EventRingIndex &index, const uint8_t value)
+    {
+        __asm__ __volatile__("" ::: "memory"); // write the slot before the index
+        index = value;
+    }
+#else
+    /**
+     * @brief Ring index; acquire and release order the slot access on the host.
+     */
+    typedef std::atomic<uint8_t> EventRingIndex;
+
+    inline uint8_t loadIndex(const EventRingIndex &index)
+    {
+        return index.load(std::memory_order_acquire);
+    }
+
+    inline void storeIndex(EventRingIndex &index, const uint8_t value)
+    {
+        index.store(value, std::memory_order_release);
+    }
+#endif
+
+    /**
+     * @brief Template class for a lock-free single producer, single consumer event queue.
+     *
+     * Interrupts post events and the main loop takes them, without disabling interrupts:
+     *
+     *     ISR:    events.post(event); KISSLoRa_scheduler_trigger(eventTask);
+     *     loop(): while (events.take(event)) { handle(event); }
+     *
+     * Only the producer writes the head and only the consumer writes the tail, so every index has a
+     * single writer. On AVR interrupts do not nest, so all ISRs together are one producer. Events are
+     * taken in the order they were posted; an event posted to a full ring is dropped and counted.
+     *
+     * @tparam Event Event type, copied into the ring; keep it small, e.g. a type and a value.
+     * @tparam Size Number of slots, a power of 2 up to 128.
+     */
+    template <typename Event, uint8_t Size = 8>
+    class EventRing
+    {
+        static_assert(Size > 0 && Size <= 128 && (Size & (Size - 1)) == 0, "Size must be a power of 2 up to 128");
+
+    public:
+        /**
+         * @brief Constructor for EventRing.
+         */
+        EventRing() : head(0), tail(0), dropped(0)
+        {
+        }
+
+        /**
+         * @brief Adds an event; producer side, e.g. an ISR.
+         *
+         * @param event The event.
+         * @return bool False if the ring is full and the event was dropped.
+         */
+        bool post(const Event &event)
+        {
+            const uint8_t position = loadIndex(head);
+            if (static_cast<uint8_t>(position - loadIndex(tail)) >= Size)
+            {
+                if (dropped != 0xFF)
+                {
+                    dropped = dropped + 1;
+                }
+                return false;
+            }
+            events[position & (Size - 1)] = event;
+            storeIndex(head, position + 1);
+            return true;
+        }
+
+        /**
+         * @brief Takes the oldest event; consumer side, e.g. the main loop.
+         *
+         * @param event Receives the event.
+         * @return bool False if the ring is empty.
+         */
+        bool take(Event &event)
+        {
+            const uint8_t position = loadIndex(tail);
+            if (position == loadIndex(head))
+            {
+                return false;
+            }
+            event = events[position & (Size - 1)];
+            storeIndex(tail, position + 1);
+            return true;
+        }
+
+        /**
+         * @brief Checks whether events are waiting; safe on both sides.
+         * @return bool True if the ring is empty.
+         */
+        bool isEmpty() const
+        {
+            return loadIndex(head) == loadIndex(tail);
+        }
+
+        /**
+         * @brief Gets the number of dropped events, saturating at 255.
+         * @return uint8_t Number of events posted to a full ring.
+         */
+        uint8_t getDroppedCount() const
+        {
+            return dropped;
+        }
+
+    private:
+        Event events[Size];
+        EventRingIndex head;        // next slot to write, producer only
+        EventRingIndex tail;        // next slot to read, consumer only
+        volatile uint8_t dropped;   // producer only
+    }; // End of class EventRing.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // EVENT_RING_HPP
@@ -0,0 +1,303 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef FRAME_POOL_HPP
+#define FRAME_POOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CayenneLPP.hpp"
+#if defined(__AVR__)
+#include <util/atomic.h>
+#endif
+
+#if defined(__AVR__)
+#define FRAME_POOL_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define FRAME_POOL_ATOMIC
+#endif
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief States of a frame in a FramePool.
+     */
+    enum class FRAME_STATES : uint8_t
+    {
+        FRAME_FREE      = 0,    /**< Available for acquire(). */
+        FRAME_FILLING   = 1,    /**< Owned by a producer, fields are being added. */
+        FRAME_READY     = 2,    /**< Committed, waiting for take(). */
+        FRAME_SENDING   = 3     /**< Owned by the sender until release(). */
+    };
+
+    /**
+     * @brief Template class for a statically allocated pool of CayenneLPP frames.
+     *
+     * Lets the next frame be filled while the previous one is transmitted. Every frame goes through
+     *
+     *     FREE -> acquire() -> FILLING -> commit() -> READY -> take() -> SENDING -> release() -> FREE
+     *
+     * and committed frames are taken in commit order. All state changes run with interrupts disabled
+     * on AVR, so producers in ISRs and the main loop can share one pool:
+     *
+     *     ISR:    pool.append([](PAYLOAD_ENCODER::CayenneLPP<51> &lpp) { return lpp.addPresence(6, 1); });
+     *     loop(): pool.commitCurrent();
+     *             PAYLOAD_ENCODER::CayenneLPP<51> *frame = pool.take();
+     *             if (frame) { ttn.sendBytes(frame->getBuffer(), frame->getSize()); pool.release(frame); }
+     *
+     * A frame returned by acquire() or take() belongs to the caller until commit() or release(), so it
+     * can be filled or sent with interrupts enabled.
+     *
+     * @tparam MaxSize Maximum size of every frame.
+     * @tparam Count Number of frames, 2 for double and 3 for triple buffering.
+     */
+    template <size_t MaxSize, uint8_t Count = 2>
+    class FramePool
+    {
+    public:
+        /**
+         * @brief Constructor for FramePool.
+         *
+         * @param size Operational size of every frame, normally the max payload of the current data rate.
+         */
+        explicit FramePool(const uint8_t size) : current(NO_FRAME), ticket(0), operationalSize(size)
+        {
+            for (uint8_t i = 0; i < Count; i++)
+            {
+                frames[i].setOperationalSize(size);
+                states[i] = FRAME_STATES::FRAME_FREE;
+                order[i] = 0;
+            }
+        }
+
+        /**
+         * @brief Changes the operational size of frames acquired from now on, e.g. after the data rate changed.
+         *
+         * @param size New operational size.
+         */
+        void setOperationalSize(const uint8_t size)
+        {
+            FRAME_POOL_ATOMIC
+            {
+                operationalSize = size;
+            }
+        }
+
+        /**
+         * @brief Takes a free frame for exclusive filling.
+         *
+         * @return CayenneLPP<MaxSize>* The empty frame, or nullptr if no frame is free.
+         */
+        CayenneLPP<MaxSize> *acquire()
+        {
+            CayenneLPP<MaxSize> *frame = nullptr;
+            FRAME_POOL_ATOMIC
+            {
+                const uint8_t index = acquireIndex();
+                frame = index == NO_FRAME ? nullptr : &frames[index];
+            }
+            return frame;
+        }
+
+        /**
+         * @brief Queues a filled frame for sending.
+         *
+         * @param frame A frame from acquire().
+         * @return bool False if the frame is not being filled.
+         */
+        bool commit(CayenneLPP<MaxSize> *frame)
+        {
+            bool committed = false;
+            FRAME_POOL_ATOMIC
+            {
+                committed = commitIndex(indexOf(frame));
+            }
+            return committed;
+        }
+
+        /**
+         * @brief Adds fields to the shared current frame, starting a new frame when it is full.
+         *
+         * The function runs with interrupts disabled, so keep it short (a few add* calls). When the
+         * current frame has no room, it is committed and the function is called again on a new frame.
+         *
+         * @param add Callable that takes CayenneLPP<MaxSize> & and returns the result of its add* call.
+         * @return uint8_t Returns the new size of the current frame, or 0 if no frame was free or the
+         *                 fields do not fit in an empty frame.
+         */
+        template <typename Function>
+        const uint8_t append(Function add)
+        {
+            uint8_t result = 0;
+            FRAME_POOL_ATOMIC
+            {
+                if (current == NO_FRAME)
+                {
+                    current = acquireIndex();
+                }
+                if (current != NO_FRAME)
+                {
+                    result = add(frames[current]);
+                    if (result == 0 && frames[current].getSize() > 0)
+                    {
+                        commitIndex(current);
+                        current = acquireIndex();
+                        result = current == NO_FRAME ? 0 : add(frames[current]);
+                    }
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Queues the shared current frame for sending, if it holds any field.
+         *
+         * @return bool True if a frame was committed.
+         */
+        bool commitCurrent()
+        {
+            bool committed = false;
+            FRAME_POOL_ATOMIC
+            {
+                if (current != NO_FRAME && frames[current].getSize() > 0)
+                {
+                    committed = commitIndex(current);
+                    current = NO_FRAME;
+                }
+            }
+            return committed;
+        }
+
+        /**
+         * @brief Takes the oldest committed frame for sending.
+         *
+         * @return CayenneLPP<MaxSize>* The frame, or nullptr if no frame is ready.
+         */
+        CayenneLPP<MaxSize> *take()
+        {
+            CayenneLPP<MaxSize> *frame = nullptr;
+            FRAME_POOL_ATOMIC
+            {
+                uint8_t oldest = NO_FRAME;
+                for (uint8_t i = 0; i < Count; i++)
+                {
+                    if (states[i] == FRAME_STATES::FRAME_READY
+                        && (oldest == NO_FRAME || static_cast<uint8_t>(order[i] - order[oldest]) >= 0x80))
+                    {
+                        oldest = i;
+                    }
+                }
+                if (oldest != NO_FRAME)
+                {
+                    states[oldest] = FRAME_STATES::FRAME_SENDING;
+                    frame = &frames[oldest];
+                }
+            }
+            return frame;
+        }
+
+        /**
+         * @brief Returns a sent frame to the pool.
+         *
+         * @param frame A frame from take().
+         * @return bool False if the frame is not being sent.
+         */
+        bool release(CayenneLPP<MaxSize> *frame)
+        {
+            bool released = false;
+            FRAME_POOL_ATOMIC
+            {
+                const uint8_t index = indexOf(frame);
+                if (index != NO_FRAME && states[index] == FRAME_STATES::FRAME_SENDING)
+                {
+                    states[index] = FRAME_STATES::FRAME_FREE;
+                    released = true;
+                }
+            }
+            return released;
+        }
+
+        /**
+         * @brief Gets the number of frames waiting for take().
+         * @return uint8_t Number of committed frames.
+         */
+        uint8_t getReadyCount() const
+        {
+            uint8_t ready = 0;
+            FRAME_POOL_ATOMIC
+            {
+                for (uint8_t i = 0; i < Count; i++)
+                {
+                    ready += states[i] == FRAME_STATES::FRAME_READY;
+                }
+            }
+            return ready;
+        }
+
+    private:
+        static const uint8_t NO_FRAME = 0xFF;
+        CayenneLPP<MaxSize> frames[Count];
+        volatile FRAME_STATES states[Count];
+        uint8_t order[Count];               // commit ticket of every READY frame
+        volatile uint8_t current;           // frame used by append(), NO_FRAME if none
+        uint8_t ticket;
+        uint8_t operationalSize;            // operational size of newly acquired frames
+
+        /**
+         * @brief Finds and resets a free frame. Interrupts must be disabled.
+         * @return uint8_t The index, or NO_FRAME.
+         */
+        uint8_t acquireIndex()
+        {
+            for (uint8_t i = 0; i < Count; i++)
+            {
+                if (states[i] == FRAME_STATES::FRAME_FREE)
+                {
+                    states[i] = FRAME_STATES::FRAME_FILLING;
+                    frames[i].reset();
+                    frames[i].setOperationalSize(operationalSize);
+                    return i;
+                }
+            }
+            return NO_FRAME;
+        }
+
+        /**
+         * @brief Moves a frame from FILLING to READY. Interrupts must be disabled.
+         * @param index The frame index.
+         * @return bool False if the frame is not being filled.
+         */
+        bool commitIndex(const uint8_t index)
+        {
+            if (index == NO_FRAME || states[index] != FRAME_STATES::FRAME_FILLING)
+            {
+                return false;
+            }
+            order[index] = ticket++;
+            states[index] = FRAME_STATES::FRAME_READY;
+            return true;
+        }
+
+        /**
+         * @brief Maps a frame pointer back to its index.
+         * @param frame The frame.
+         * @return uint8_t The index, or NO_FRAME for a pointer that is not in the pool.
+         */
+        uint8_t indexOf(const CayenneLPP<MaxSize> *frame) const
+        {
+            for (uint8_t i = 0; i < Count; i++)
+            {
+                if (frame == &frames[i])
+                {
+                    return i;
+                }
+            }
+            return NO_FRAME;
+        }
+    }; // End of class FramePool.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // FRAME_POOL_HPP
@@ -0,0 +1,269 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef PRIORITY_PACKER_HPP
+#define PRIORITY_PACKER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CayenneLPP.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Priority of fields that must be in every frame, e.g. presence or alarm channels.
+     *
+     * Critical fields are packed before all others and never expire.
+     */
+    static const uint8_t FIELD_PRIORITY_CRITICAL = 0xFF;
+
+    /**
+     * @brief One field waiting in a PriorityPacker.
+     */
+    struct PendingField
+    {
+        DATA_TYPES type;        /**< LPP data type. */
+        uint8_t channel;        /**< LPP channel. */
+        uint8_t priority;       /**< Higher is packed first, FIELD_PRIORITY_CRITICAL is always packed. */
+        uint8_t valueCount;     /**< 1, or 3 for xyz, colour and GPS types; 0 marks a free slot. */
+        int32_t values[3];      /**< Values in units of the type resolution. */
+        uint32_t deadline;      /**< Time after which the field is stale and dropped, same clock as pack(). */
+    };
+
+    /**
+     * @brief Template class that packs queued fields into frames of limited size by priority.
+     *
+     * Fields are queued as they are measured and pack() fills the frame of the next uplink:
+     * critical fields first, then the others from high to low priority (the earliest deadline
+     * first among equal priorities). A field that does not fit is rolled back and stays queued for
+     * the next uplink, while smaller fields after it can still fill the frame. Fields past their
+     * deadline are dropped. Queuing a type and channel that is already waiting replaces the old
+     * value, so a deferred reading never goes out after a newer one.
+     *
+     * @tparam MaxFields Maximum number of queued fields.
+     */
+    template <uint8_t MaxFields>
+    class PriorityPacker
+    {
+    public:
+        /**
+         * @brief Constructor for PriorityPacker.
+         */
+        PriorityPacker() : dropped(0)
+        {
+            for (uint8_t i = 0; i < MaxFields; i++)
+            {
+                fields[i].valueCount = 0;
+            }
+        }
+
+        /**
+         * @brief Queues a single-value field.
+         *
+         * @param type The data type.
+         * @param channel The channel number.
+         * @param value The value in units of the type resolution.
+         * @param priority The priority, FIELD_PRIORITY_CRITICAL for fields that must always be sent.
+         * @param deadline Time after which the value is stale, e.g. millis() + 600000.
+         * @return bool False if the queue is full of fields with the same or a higher priority.
+         */
+        bool queue(const DATA_TYPES type, const uint8_t channel, const FixedPoint value, const uint8_t priority, const uint32_t deadline)
+        {
+            const int32_t values[3] = {value.get(), 0, 0};
+            return queueValues(type, channel, values, 1, priority, deadline);
+        }
+
+        /**
+         * @brief Queues a single-value field from a float, scaled with the type resolution.
+         *
+         * @param type The data type.
+         * @param channel The channel number.
+         * @param value The value in its unit, e.g. 21.5 for 21.5 °C.
+         * @param priority The priority.
+         * @param deadline Time after which the value is stale.
+         * @return bool False if the queue is full of fields with the same or a higher priority.
+         */
+        bool queue(const DATA_TYPES type, const uint8_t channel, const float value, const uint8_t priority, const uint32_t deadline)
+        {
+            const float scaled = value * FLOATING_DATA_RESOLUTION(type);
+            return queue(type, channel, FixedPoint(static_cast<int32_t>(scaled > 0 ? scaled + 0.5f : scaled - 0.5f)), priority, deadline);
+        }
+
+        /**
+         * @brief Queues a three-value field (xyz, colour or GPS).
+         *
+         * @param type The data type.
+         * @param channel The channel number.
+         * @param first The first value in units of the type resolution.
+         * @param second The second value in units of the type resolution.
+         * @param third The third value in units of the type resolution.
+         * @param priority The priority.
+         * @param deadline Time after which the value is stale.
+         * @return bool False if the queue is full of fields with the same or a higher priority.
+         */
+        bool queue(const DATA_TYPES type, const uint8_t channel, const FixedPoint first, const FixedPoint second,
+            const FixedPoint third, const uint8_t priority, const uint32_t deadline)
+        {
+            const int32_t values[3] = {first.get(), second.get(), third.get()};
+            return queueValues(type, channel, values, 3, priority, deadline);
+        }
+
+        /**
+         * @brief Packs queued fields into a frame; the packed fields are removed from the queue.
+         *
+         * @param lpp The frame, normally reset and with the operational size set to the current max payload.
+         * @param now Current time, from the same clock as the deadlines.
+         * @return uint8_t Returns the size of the frame.
+         */
+        template <size_t MaxSize>
+        const uint8_t pack(CayenneLPP<MaxSize> &lpp, const uint32_t now)
+        {
+            dropStale(now);
+            bool tried[MaxFields] = {};
+            for (;;)
+            {
+                const uint8_t index = selectNext(tried);
+                if (index == NO_FIELD)
+                {
+                    break;
+                }
+                tried[index] = true;
+                const PendingField &field = fields[index];
+                const size_t mark = lpp.checkpoint();
+                const uint8_t result = field.valueCount == 3
+                    ? lpp.addValue(field.type, field.channel, FixedPoint(field.values[0]), FixedPoint(field.values[1]), FixedPoint(field.values[2]))
+                    : lpp.addValue(field.type, field.channel, FixedPoint(field.values[0]));
+                if (result == 0)
+                {
+                    lpp.rollback(mark);
+                    continue;
+                }
+                fields[index].valueCount = 0;
+            }
+            return static_cast<uint8_t>(lpp.getSize());
+        }
+
+        /**
+         * @brief Gets the number of queued fields.
+         * @return uint8_t Number of fields waiting for an uplink.
+         */
+        uint8_t getPendingCount() const
+        {
+            uint8_t pending = 0;
+            for (uint8_t i = 0; i < MaxFields; i++)
+            {
+                pending += fields[i].valueCount != 0;
+            }
+            return pending;
+        }
+
+        /**
+         * @brief Gets the number of fields dropped because they were stale or pushed out of a full queue.
+         * @return uint16_t Number of dropped fields.
+         */
+        uint16_t getDroppedCount() const
+        {
+            return dropped;
+        }
+
+    private:
+        static const uint8_t NO_FIELD = 0xFF;
+        PendingField fields[MaxFields];
+        uint16_t dropped;
+
+        /**
+         * @brief Stores a field, replacing a waiting field with the same type and channel.
+         */
+        bool queueValues(const DATA_TYPES type, const uint8_t channel, const int32_t *values, const uint8_t valueCount,
+            const uint8_t priority, const uint32_t deadline)
+        {
+            if (getDataTypeValueCount(type) != valueCount || getDataTypeSize(type) == 0)
+            {
+                return false;
+            }
+            uint8_t slot = NO_FIELD;
+            for (uint8_t i = 0; i < MaxFields && slot == NO_FIELD; i++)
+            {
+                if (fields[i].valueCount != 0 && fields[i].type == type && fields[i].channel == channel)
+                {
+                    slot = i;
+                }
+            }
+            for (uint8_t i = 0; i < MaxFields && slot == NO_FIELD; i++)
+            {
+                if (fields[i].valueCount == 0)
+                {
+                    slot = i;
+                }
+            }
+            if (slot == NO_FIELD)
+            {
+                // Push out the lowest priority field if the new one is more important.
+                for (uint8_t i = 0; i < MaxFields; i++)
+                {
+                    if (fields[i].priority < priority && (slot == NO_FIELD || fields[i].priority < fields[slot].priority))
+                    {
+                        slot = i;
+                    }
+                }
+                if (slot == NO_FIELD)
+                {
+                    return false;
+                }
+                dropped++;
+            }
+            PendingField &field = fields[slot];
+            field.type = type;
+            field.channel = channel;
+            field.priority = priority;
+            field.valueCount = valueCount;
+            field.values[0] = values[0];
+            field.values[1] = values[1];
+            field.values[2] = values[2];
+            field.deadline = deadline;
+            return true;
+        }
+
+        /**
+         * @brief Removes the non-critical fields whose deadline has passed.
+         */
+        void dropStale(const uint32_t now)
+        {
+            for (uint8_t i = 0; i < MaxFields; i++)
+            {
+                if (fields[i].valueCount != 0 && fields[i].priority != FIELD_PRIORITY_CRITICAL
+                    && static_cast<int32_t>(now - fields[i].deadline) > 0)
+                {
+                    fields[i].valueCount = 0;
+                    dropped++;
+                }
+            }
+        }
+
+        /**
+         * @brief Finds the untried field with the highest priority, the earliest deadline breaking ties.
+         */
+        uint8_t selectNext(const bool *tried) const
+        {
+            uint8_t best = NO_FIELD;
+            for (uint8_t i = 0; i < MaxFields; i++)
+            {
+                if (fields[i].valueCount == 0 || tried[i])
+                {
+                    continue;
+                }
+                if (best == NO_FIELD || fields[i].priority > fields[best].priority
+                    || (fields[i].priority == fields[best].priority && static_cast<int32_t>(fields[i].deadline - fields[best].deadline) < 0))
+                {
+                    best = i;
+                }
+            }
+            return best;
+        }
+    }; // End of class PriorityPacker.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // PRIORITY_PACKER_HPP
@@ -54,6 +54,10 @@
 
 #define CRC_POLY 0x988000 // Shifted Polynomial for CRC check
 
+// Time in ms a result may take after its max. conversion time, e.g. when
+// the MCU slept during the conversion and its clock stopped
+#define READ_TIMEOUT 25
+
 // Error codes
 #define I2C_TIMEOUT 	998
 #define BAD_CRC		999
@@ -80,11 +84,21 @@ public:
 	void  reset();
 	uint8_t  checkID();
 
+	// Measurement without waiting, e.g. while the radio wakes up
+	void  startMeasurement(uint8_t command);
+	bool  isReady();
+	float readResult();
+	void  setSleep(void (*sleep)(unsigned long ms));
 
 
 private:
 	//Si7021 & HTU21D Private Functions
-	uint16_t makeMeasurment(uint8_t command);
+	uint16_t readMeasurment(uint8_t command);
+	unsigned long conversionTime(uint8_t command);
+	uint8_t  resolution;          // setting of changeResolution()
+	uint8_t  measureCommand;
+	unsigned long measureStart;   // micros() at startMeasurement()
+	void (*sleepFunction)(unsigned long ms);
 	void     writeReg(uint8_t value);
 	uint8_t  readReg();
 };
@@ -0,0 +1,372 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef TIME_SERIES_HPP
+#define TIME_SERIES_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "CayenneReferences.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Size of the time-series header: type, channel, sample count and a two-byte age.
+     */
+    static const uint8_t TIME_SERIES_HEADER_SIZE = 5;
+
+    /**
+     * @brief One decoded sample of a time-series frame.
+     */
+    struct TimeSeriesSample
+    {
+        uint32_t timestamp;     /**< Absolute time of the sample in seconds. */
+        int32_t scaledValue;    /**< Value in units of the data type resolution, e.g. 0.1 °C. */
+    };
+
+    /**
+     * @brief Returns the number of bytes needed to store a value as LEB128 varint.
+     * @param value The value.
+     * @return uint8_t Number of bytes (1..5).
+     */
+    const static inline uint8_t getVarintSize(uint32_t value)
+    {
+        uint8_t size = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    /**
+     * @brief Maps a signed value to unsigned so small negative deltas stay small (zigzag encoding).
+     * @param value The signed value.
+     * @return uint32_t The zigzag encoded value.
+     */
+    const static inline uint32_t zigzagEncode(const int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    /**
+     * @brief Reverses zigzagEncode().
+     * @param value The zigzag encoded value.
+     * @return int32_t The signed value.
+     */
+    const static inline int32_t zigzagDecode(const uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    /**
+     * @brief Template class for multi-sample time-series frames.
+     *
+     * Collects samples of one channel/type and sends them in a single uplink:
+     *
+     *     [type][channel][count][age LSB][age MSB] value0 (dt1 dv1) (dt2 dv2) ...
+     *
+     * The first value is a zigzag varint, every following sample is a varint time delta in seconds
+     * and a zigzag varint value delta. The age is the number of seconds between the newest sample
+     * and finalize(), so the backend can anchor the series at the uplink receive time. Samples that
+     * no longer fit in the operational size are refused, so the caller can send and start over.
+     *
+     * @tparam MaxSize Maximum size of the buffer.
+     */
+    template <size_t MaxSize>
+    class TimeSeriesEncoder
+    {
+    public:
+        /**
+         * @brief Constructor for TimeSeriesEncoder.
+         *
+         * @param size Size of the buffer, normally the max payload of the current data rate.
+         */
+        explicit TimeSeriesEncoder(const uint8_t size) : operationalSize(size > MaxSize ? MaxSize : size), currentIndex(0), lastTimestamp(0), lastValue(0)
+        {
+            reset(DATA_TYPES::ANL_IN, 0);
+        }
+
+        /**
+         * @brief Starts a new series.
+         *
+         * @param dataType The data type of all samples.
+         * @param sensorChannel The channel of all samples.
+         */
+        void reset(const DATA_TYPES dataType, const uint8_t sensorChannel)
+        {
+            buffer[0] = static_cast<uint8_t>(dataType);
+            buffer[1] = sensorChannel;
+            buffer[2] = 0;
+            buffer[3] = 0;
+            buffer[4] = 0;
+            currentIndex = TIME_SERIES_HEADER_SIZE;
+        }
+
+        /**
+         * @brief Changes the operational size, e.g. after the data rate changed.
+         *
+         * @param size New size of the buffer. It is not reduced below the size already in use.
+         */
+        void setOperationalSize(const uint8_t size)
+        {
+            operationalSize = size > MaxSize ? MaxSize : size;
+            if (operationalSize < currentIndex)
+            {
+                operationalSize = currentIndex;
+            }
+        }
+
+        /**
+         * @brief Adds a sample as integer in units of the data type resolution.
+         *
+         * @param timestamp Time of the sample in seconds, from any monotonic clock.
+         * @param scaled The value, e.g. 215 for 21.5 °C.
+         * @return uint8_t Returns the new size of the payload, or 0 if the sample does not fit, the series
+         *                 is full or the timestamp is older than the previous sample.
+         */
+        const uint8_t addScaledSample(const uint32_t timestamp, const int32_t scaled)
+        {
+            const uint8_t count = buffer[2];
+            if (count == 0xFF || (count > 0 && timestamp < lastTimestamp))
+            {
+                return 0;
+            }
+            const uint32_t dt = timestamp - lastTimestamp;
+            const uint32_t dv = zigzagEncode(count > 0 ? scaled - lastValue : scaled);
+            const size_t needed = (count > 0 ? getVarintSize(dt) : 0) + getVarintSize(dv);
+            if (currentIndex + needed > operationalSize)
+            {
+                return 0;
+            }
+            if (count > 0)
+            {
+                appendVarint(dt);
+            }
+            appendVarint(dv);
+            buffer[2] = count + 1;
+            lastTimestamp = timestamp;
+            lastValue = scaled;
+            return currentIndex;
+        }
+
+        /**
+         * @brief Adds a sample as float; it is scaled with FLOATING_DATA_RESOLUTION() of the series type.
+         *
+         * @param timestamp Time of the sample in seconds, from any monotonic clock.
+         * @param value The value, e.g. 21.5 for 21.5 °C.
+         * @return uint8_t Returns the new size of the payload, or 0 if the sample was refused.
+         */
+        const uint8_t addSample(const uint32_t timestamp, const float value)
+        {
+            const int16_t resolution = FLOATING_DATA_RESOLUTION(static_cast<DATA_TYPES>(buffer[0]));
+            const float scaled = value * (resolution ? resolution : 1);
+            return addScaledSample(timestamp, static_cast<int32_t>(scaled > 0 ? scaled + 0.5f : scaled - 0.5f));
+        }
+
+        /**
+         * @brief Writes the age of the newest sample; call right before sending.
+         *
+         * @param now Current time in seconds, from the same clock as the sample timestamps.
+         * @return uint8_t Returns the size of the payload.
+         */
+        const uint8_t finalize(const uint32_t now)
+        {
+            uint32_t age = (buffer[2] > 0 && now > lastTimestamp) ? now - lastTimestamp : 0;
+            if (age > 0xFFFF)
+            {
+                age = 0xFFFF;
+            }
+            buffer[3] = static_cast<uint8_t>(age);
+            buffer[4] = static_cast<uint8_t>(age >> 8);
+            return currentIndex;
+        }
+
+        /**
+         * @brief Gets the number of samples in the series.
+         * @return uint8_t Number of samples.
+         */
+        uint8_t getCount(void) const
+        {
+            return buffer[2];
+        }
+
+        /**
+         * @brief Gets the size of the payload.
+         * @return size_t Number of used bytes.
+         */
+        size_t getSize(void) const
+        {
+            return currentIndex;
+        }
+
+        /**
+         * @brief Returns the buffer.
+         * @return const uint8_t* Pointer to the buffer.
+         */
+        const uint8_t *getBuffer(void) const
+        {
+            return buffer;
+        }
+
+    private:
+        uint8_t buffer[MaxSize < TIME_SERIES_HEADER_SIZE ? TIME_SERIES_HEADER_SIZE : MaxSize];
+        size_t operationalSize;
+        size_t currentIndex;
+        uint32_t lastTimestamp;
+        int32_t lastValue;
+
+        /**
+         * @brief Appends a LEB128 varint to the buffer. Capacity must be checked by the caller.
+         * @param value The value to append.
+         */
+        void appendVarint(uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer[currentIndex++] = static_cast<uint8_t>(value) | 0x80;
+                value >>= 7;
+            }
+            buffer[currentIndex++] = static_cast<uint8_t>(value);
+        }
+    }; // End of class TimeSeriesEncoder.
+
+    /**
+     * @brief Decoder for time-series frames, reconstructs absolute timestamps.
+     */
+    class TimeSeriesView
+    {
+    public:
+        /**
+         * @brief Constructor for TimeSeriesView.
+         *
+         * @param buffer The frame. Must stay valid while the view is used.
+         * @param size The size of the frame in bytes.
+         */
+        TimeSeriesView(const uint8_t *buffer, const size_t size) : buffer(buffer), size(buffer ? size : 0) {}
+
+        /**
+         * @brief Gets the data type of the series.
+         * @return DATA_TYPES The data type.
+         */
+        DATA_TYPES type() const
+        {
+            return static_cast<DATA_TYPES>(size > 0 ? buffer[0] : 0);
+        }
+
+        /**
+         * @brief Gets the channel of the series.
+         * @return uint8_t The channel number.
+         */
+        uint8_t channel() const
+        {
+            return size > 1 ? buffer[1] : 0;
+        }
+
+        /**
+         * @brief Gets the number of samples in the series.
+         * @return uint8_t Number of samples.
+         */
+        uint8_t count() const
+        {
+            return size > 2 ? buffer[2] : 0;
+        }
+
+        /**
+         * @brief Decodes all samples.
+         *
+         * @param referenceTime Absolute time the frame was finalized, normally the uplink receive time in seconds.
+         * @param samples Receives the samples, oldest first.
+         * @param maxSamples Capacity of samples.
+         * @return uint8_t Number of decoded samples, 0 for a malformed frame or too little room in samples.
+         */
+        uint8_t decode(const uint32_t referenceTime, TimeSeriesSample *samples, const uint8_t maxSamples) const
+        {
+            if (size < TIME_SERIES_HEADER_SIZE || count() > maxSamples)
+            {
+                return 0;
+            }
+            const uint8_t n = count();
+            size_t offset = TIME_SERIES_HEADER_SIZE;
+            uint32_t relative = 0;  // seconds since the first sample
+            int32_t value = 0;
+            for (uint8_t i = 0; i < n; i++)
+            {
+                uint32_t word;
+                if (i > 0)
+                {
+                    if (!readVarint(offset, word))
+                    {
+                        return 0;
+                    }
+                    relative += word;
+                }
+                if (!readVarint(offset, word))
+                {
+                    return 0;
+                }
+                value += zigzagDecode(word);
+                samples[i].timestamp = relative;
+                samples[i].scaledValue = value;
+            }
+            if (offset != size)
+            {
+                return 0;
+            }
+            // Anchor the newest sample at referenceTime - age and shift the others with it.
+            const uint32_t age = buffer[3] | (static_cast<uint32_t>(buffer[4]) << 8);
+            const uint32_t first = referenceTime - age - relative;
+            for (uint8_t i = 0; i < n; i++)
+            {
+                samples[i].timestamp += first;
+            }
+            return n;
+        }
+
+        /**
+         * @brief Gets the number of scaled units per unit of the series type (e.g. 10 for 0.1 °C).
+         * @return int16_t The resolution divisor, 1 for unscaled types.
+         */
+        int16_t resolution() const
+        {
+            const int16_t res = FLOATING_DATA_RESOLUTION(type());
+            return res ? res : 1;
+        }
+
+    private:
+        const uint8_t *buffer;
+        size_t size;
+
+        /**
+         * @brief Reads a LEB128 varint.
+         *
+         * @param offset Read position, advanced past the varint.
+         * @param value Receives the value.
+         * @return bool False if the varint runs past the end of the frame or is longer than 5 bytes.
+         */
+        bool readVarint(size_t &offset, uint32_t &value) const
+        {
+            value = 0;
+            for (uint8_t shift = 0; shift < 35; shift += 7)
+            {
+                if (offset >= size)
+                {
+                    return false;
+                }
+                const uint8_t current = buffer[offset++];
+                value |= static_cast<uint32_t>(current & 0x7F) << shift;
+                if (!(current & 0x80))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }; // End of class TimeSeriesView.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // TIME_SERIES_HPP
@@ -6,6 +6,24 @@
 #include "CayenneLPP.hpp"
 #include <TheThingsNetwork_IOT.h>
 #include "SparkFun_Si7021_Breakout_Library.h" //Include for the temperature and humidity sensor
+#include "CayenneBenchmark.hpp"
+#include "CayenneLPPStream.hpp"
+#include "DeltaPayload.hpp"
+
+/** @brief Set to 1 to print the float vs. fixed-point encoder benchmark at startup. */
+#define RUN_ENCODER_BENCHMARK 0
+
+/** @brief Set to 1 to stream the frame into the modem instead of building it in the lpp buffer. */
+#define USE_STREAMED_PAYLOAD 0
+
+/** @brief Set to 1 to send keyframes and delta frames (DeltaPayload.hpp) instead of full frames. */
+#define USE_DELTA_PAYLOAD 0
+
+/** @brief LoRaWAN port for keyframes and delta frames. */
+#define APPLICATION_PORT_DELTA 101
+
+/** @brief Number of uplinks per keyframe; a receiver that lost a frame waits at most this many uplinks. */
+#define DELTA_KEYFRAME_INTERVAL 16
 
 /** @brief The AppEUI for connecting to The Things Network. */
 const char* AppEUI = "0000000000000000";
@@ -27,12 +45,33 @@ const char* AppKey = "C30F1715DFA6B9F21C2DCB07AC65FF00";
 /** @brief Initialize Cayenne LPP payload encoder. */
 PAYLOAD_ENCODER::CayenneLPP<51> lpp(50);
 
+#if USE_DELTA_PAYLOAD == 1
+/** @brief Keyframe/delta encoder. */
+PAYLOAD_ENCODER::DeltaEncoder<51> delta(51, DELTA_KEYFRAME_INTERVAL);
+#endif
+
 /** @brief Temperature and humidity sensor object. */
 Weather sensor;
 
 /** @brief TheThingsNetwork object for LoRa communication. */
 TheThingsNetwork ttn(loraSerial, debugSerial);
 
+/**
+   @brief Frame that is encoded while it is sent, see TheThingsNetwork::sendBytes(const Printable &).
+*/
+class WeatherFrame : public Printable {
+public:
+  float temperature; ///< Temperature in degrees Celsius.
+  float humidity;    ///< Relative humidity in %.
+
+  size_t printTo(Print &out) const {
+    PAYLOAD_ENCODER::CayenneLPPStream stream(out, 50);
+    stream.addTemperature(1, temperature); // Add temperature data (Channel 1)
+    stream.addHumidity(2, humidity); // Add humidity data (Channel 2)
+    return stream.getSize();
+  }
+};
+
 /**
    @brief Arduino setup function.
           Initializes serial ports, LED pin, sensor, and joins The Things Network.
@@ -47,6 +86,11 @@ void setup() {
   // Wait a maximum of 10s for Serial Monitor
   while (!debugSerial && millis() < 10000);
 
+#if RUN_ENCODER_BENCHMARK == 1
+  debugSerial.println("-- ENCODER BENCHMARK");
+  PAYLOAD_ENCODER::benchmarkFixedPoint(debugSerial);
+#endif
+
   debugSerial.println("-- STATUS");
   ttn.showStatus();
 
@@ -73,6 +117,21 @@ void loop() {
   debugSerial.print(temperature);
   debugSerial.println(F(" Degrees."));
 
+#if USE_STREAMED_PAYLOAD == 1
+  /** @brief  // Encode and send the Cayenne LPP payload in one pass*/
+  WeatherFrame frame;
+  frame.temperature = temperature;
+  frame.humidity = humidity;
+  ttn.sendBytes(frame);
+#elif USE_DELTA_PAYLOAD == 1
+  /** @brief  // Add sensor data to the frame, only changed values are sent between keyframes*/
+  delta.frame().reset();
+  delta.frame().addTemperature(1, temperature); // Add temperature data (Channel 1)
+  delta.frame().addHumidity(2, humidity); // Add humidity data (Channel 2)
+  if (delta.encode() > 0) {
+    ttn.sendBytes(delta.getBuffer(), delta.getSize(), APPLICATION_PORT_DELTA);
+  }
+#else
   /** @brief  // Add sensor data to Cayenne LPP payload*/
   lpp.reset();
   lpp.addTemperature(1, temperature); // Add temperature data (Channel 1)
@@ -80,6 +139,7 @@ void loop() {
 
   /** @brief  // Send Cayenne LPP payload over LoRaWAN*/
   ttn.sendBytes(lpp.getBuffer(), lpp.getSize());
+#endif
 
   delay(60000); // Wait for some time before sending again (60 seconds in this case)
 }
@@ -0,0 +1,94 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef DELTA_FLEET_DECODER_HPP
+#define DELTA_FLEET_DECODER_HPP
+
+/**
+ * @file DeltaFleetDecoder.hpp
+ * @brief Host side decoder for keyframe/delta uplinks (DeltaPayload.hpp) of many devices.
+ *
+ * Keeps one DeltaDecoder per device, so every device has its own last frame and sequence number. The
+ * result of decode() is a plain CayenneLPP frame that can go to CayenneLPPView, LppBulkDecoder or
+ * LppTextWriter. Host only: needs the C++ standard library.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include "../examples/payloadEncoderTest/DeltaPayload.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Largest LoRaWAN payload, the frame size used for every device.
+     */
+    static const size_t DELTA_FLEET_MAX_FRAME = 255;
+
+    /**
+     * @brief Per-device keyframe/delta decoder.
+     */
+    class DeltaFleetDecoder
+    {
+    public:
+        /**
+         * @brief Decodes one uplink of a device.
+         *
+         * @param device Device identifier chosen by the caller, e.g. an index into a DevEUI table.
+         * @param payload The received frame.
+         * @param size Size of the received frame.
+         * @param frame Set to the complete CayenneLPP frame for DELTA_KEYFRAME and DELTA_APPLIED,
+         *              otherwise to nullptr. Valid until the next decode() for the same device.
+         * @param frameSize Set to the size of the complete frame.
+         * @return DELTA_RESULTS The result, see DeltaDecoder::decode().
+         */
+        DELTA_RESULTS decode(const uint32_t device, const uint8_t *payload, const size_t size,
+            const uint8_t *&frame, size_t &frameSize)
+        {
+            DeltaDecoder<DELTA_FLEET_MAX_FRAME> &decoder = devices[device];
+            const DELTA_RESULTS result = decoder.decode(payload, size);
+            counts[static_cast<uint8_t>(result)]++;
+            const bool complete = result == DELTA_RESULTS::DELTA_KEYFRAME || result == DELTA_RESULTS::DELTA_APPLIED;
+            frame = complete ? decoder.getBuffer() : nullptr;
+            frameSize = complete ? decoder.getSize() : 0;
+            return result;
+        }
+
+        /**
+         * @brief Forgets the state of a device, e.g. after it rejoined.
+         * @param device Device identifier.
+         */
+        void forget(const uint32_t device)
+        {
+            devices.erase(device);
+        }
+
+        /**
+         * @brief Gets the number of decoded uplinks with a given result.
+         * @param result The result.
+         * @return size_t Number of uplinks.
+         */
+        size_t getCount(const DELTA_RESULTS result) const
+        {
+            return counts[static_cast<uint8_t>(result)];
+        }
+
+        /**
+         * @brief Gets the number of devices with state.
+         * @return size_t Number of devices.
+         */
+        size_t getDeviceCount() const
+        {
+            return devices.size();
+        }
+
+    private:
+        std::unordered_map<uint32_t, DeltaDecoder<DELTA_FLEET_MAX_FRAME>> devices;
+        size_t counts[4] = {0, 0, 0, 0};
+    }; // End of class DeltaFleetDecoder.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // DELTA_FLEET_DECODER_HPP
@@ -0,0 +1,193 @@
+/**
+ * @file FragmentReassembler.hpp
+ * @brief Host side reassembler for the fragments sent by TheThingsNetwork::sendBytes() when fragmentation is enabled
+ *        and by TheThingsNetwork::startFragments().
+ *
+ * Every fragment arrives on the fragment port (TTN_FRAGMENT_PORT by default) and starts with a two byte header:
+ *
+ *     [message ID][fragment index << 4 | last index] data...
+ *
+ * The data of all fragments together is [port][payload...], the uplink as it would have been sent without
+ * fragmentation. The device sizes every fragment for the data rate at the time it is sent, so with ADR the
+ * fragments may differ in size and the last index of early fragments is only an estimate; the final fragment
+ * (index equal to its last index) carries the real one. The header is plain C++11 and does not depend on Arduino; keep one reassembler per device,
+ * e.g. in a std::map keyed by the DevEUI.
+ */
+
+#ifndef FRAGMENT_REASSEMBLER_HPP
+#define FRAGMENT_REASSEMBLER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @class FragmentReassembler
+ * @brief Rebuilds one fragmented message at a time for a single device.
+ *
+ * Fragments may arrive in any order and duplicates are ignored. A fragment with a new message ID drops the
+ * message that was being collected, because the device only starts a new message after the previous one.
+ *
+ * The message ID restarts when the device reboots, so a new message may reuse the ID of the last delivered one.
+ * Pass the LoRaWAN frame counter of every uplink to tell a late duplicate (same frame counter) from such a
+ * message. Without frame counters a fragment with index 0 starts a new message.
+ */
+class FragmentReassembler
+{
+public:
+  /**
+   * @enum Result
+   * Result of adding a fragment.
+   */
+  enum Result
+  {
+    INCOMPLETE, ///< The fragment was stored, more fragments are needed.
+    COMPLETE,   ///< The message is complete, see port() and payload().
+    MALFORMED   ///< The fragment has an invalid header or contradicts the fragments received so far.
+  };
+
+  /**
+   * @brief Header size of every fragment, equal to TTN_FRAGMENT_HEADER_SIZE on the device.
+   */
+  static const size_t HEADER_SIZE = 2;
+
+  /**
+   * @brief Maximum number of fragments per message, equal to TTN_FRAGMENT_MAX_COUNT on the device.
+   */
+  static const size_t MAX_FRAGMENTS = 16;
+
+  /**
+   * @brief Frame counter value for fragments whose uplink frame counter is not known.
+   */
+  static const int64_t NO_FRAME_COUNTER = -1;
+
+  FragmentReassembler() : active(false), finished(false), finalKnown(false), messageId(0), lastIndex(0), received(0), messagePort(0)
+  {
+    reset();
+  }
+
+  /**
+   * @brief Adds one fragment, as received on the fragment port.
+   *
+   * @param data The uplink payload including the fragment header.
+   * @param size The size of the uplink payload.
+   * @param frameCounter The LoRaWAN frame counter (FCnt) of the uplink, NO_FRAME_COUNTER if it is not known.
+   * @return Result COMPLETE when this fragment completed the message.
+   */
+  Result addFragment(const uint8_t *data, size_t size, const int64_t frameCounter = NO_FRAME_COUNTER)
+  {
+    if (!data || size <= HEADER_SIZE)
+    {
+      return MALFORMED;
+    }
+    const uint8_t id = data[0];
+    const uint8_t index = data[1] >> 4;
+    const uint8_t last = data[1] & 0x0F;
+    if (index > last)
+    {
+      return MALFORMED;
+    }
+    if (finished && id == messageId && isDuplicate(index, frameCounter))
+    {
+      return INCOMPLETE; // late duplicate of a message that was already delivered
+    }
+    if (!active || id != messageId)
+    {
+      reset();
+      active = true;
+      messageId = id;
+    }
+    if (index == last)
+    {
+      if ((finalKnown && last != lastIndex) || (received >> (last + 1)) != 0)
+      {
+        return MALFORMED; // a second final fragment, or fragments behind the final one
+      }
+      finalKnown = true;
+      lastIndex = last;
+    }
+    else if (finalKnown && index > lastIndex)
+    {
+      return MALFORMED;
+    }
+
+    fragments[index].assign(data + HEADER_SIZE, data + size);
+    counters[index] = frameCounter;
+    received |= static_cast<uint16_t>(1u << index);
+    if (!finalKnown || received != static_cast<uint16_t>((1u << (lastIndex + 1)) - 1))
+    {
+      return INCOMPLETE;
+    }
+
+    std::vector<uint8_t> frame;
+    for (uint8_t i = 0; i <= lastIndex; i++)
+    {
+      frame.insert(frame.end(), fragments[i].begin(), fragments[i].end());
+    }
+    messagePort = frame[0];
+    message.assign(frame.begin() + 1, frame.end());
+    active = false;
+    finished = true;
+    return COMPLETE;
+  }
+
+  /**
+   * @brief Drops the message that is being collected.
+   */
+  void reset()
+  {
+    for (size_t i = 0; i < MAX_FRAGMENTS; i++)
+    {
+      fragments[i].clear();
+      counters[i] = NO_FRAME_COUNTER;
+    }
+    active = false;
+    finished = false;
+    finalKnown = false;
+    received = 0;
+  }
+
+  /**
+   * @brief Gets the original port of the last completed message.
+   * @return uint8_t The port passed to sendBytes() on the device.
+   */
+  uint8_t port() const
+  {
+    return messagePort;
+  }
+
+  /**
+   * @brief Gets the payload of the last completed message.
+   * @return const std::vector<uint8_t>& The payload passed to sendBytes() on the device.
+   */
+  const std::vector<uint8_t> &payload() const
+  {
+    return message;
+  }
+
+private:
+  /**
+   * @brief Checks whether a fragment with the ID of the delivered message belongs to that message.
+   */
+  bool isDuplicate(const uint8_t index, const int64_t frameCounter) const
+  {
+    if (frameCounter != NO_FRAME_COUNTER && counters[index] != NO_FRAME_COUNTER)
+    {
+      return frameCounter == counters[index];
+    }
+    return index != 0; // the device sends index 0 first: the same ID again means it rebooted
+  }
+
+  bool active;
+  bool finished;
+  bool finalKnown;
+  uint8_t messageId;
+  uint8_t lastIndex;
+  uint16_t received;
+  uint8_t messagePort;
+  std::vector<uint8_t> fragments[MAX_FRAGMENTS];
+  int64_t counters[MAX_FRAGMENTS];
+  std::vector<uint8_t> message;
+};
+
+#endif // FRAGMENT_REASSEMBLER_HPP
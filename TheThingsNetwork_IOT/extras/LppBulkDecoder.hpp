@@ -0,0 +1,588 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef LPP_BULK_DECODER_HPP
+#define LPP_BULK_DECODER_HPP
+
+/**
+ * @file LppBulkDecoder.hpp
+ * @brief Host side batch decoder for Cayenne LPP uplinks, meant for backend ingestion.
+ *
+ * Decodes arrays of frames into columns per (device, channel, type). A fleet running the same firmware sends
+ * the same field layout over and over, so the decoder learns each layout once and then decodes matching frames
+ * on a fixed-layout fast path:
+ *  - the header bytes of a frame are verified against the layout with one masked SIMD compare;
+ *  - all values are gathered into 16-bit lanes with byte shuffles (which also do the endian swap for the
+ *    standard big-endian format) and widened to int32 with per-lane sign or zero extension.
+ *
+ * The fast path uses AVX2 when compiled with -mavx2, SSE4.1 with -msse4.1 and a scalar version of the same
+ * tables otherwise. Frames with another layout, with values wider than 16 bits (GPS), with values that need
+ * rescaling (standard format humidity) or larger than LPP_BULK_MAX_FRAME bytes are decoded with CayenneLPPView.
+ * Host only: needs the C++ standard library and threads.
+ *
+ * All SIMD loads and stores are unaligned: the layouts live in a std::vector, which does not honour over-aligned
+ * types before C++17. On current cores unaligned loads of aligned data cost the same.
+ *
+ * The gain over CayenneLPPView is modest: LppBulkBenchmark measured 2.7M against 2.34M frames/s on one core
+ * with AVX2, about 16%. The per-frame work outside the decode (layout lookup, column store) dominates; most of
+ * the throughput for bulk ingestion comes from decodeLppParallel() over several cores.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+#include "../examples/payloadEncoderTest/CayenneLPPView.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Largest frame that can take the fast path, in bytes.
+     */
+    static const size_t LPP_BULK_MAX_FRAME = 64;
+
+    /**
+     * @brief Largest number of values in a frame that can take the fast path.
+     */
+    static const size_t LPP_BULK_MAX_VALUES = 32;
+
+    /**
+     * @brief Maximum number of layouts one decoder remembers.
+     */
+    static const size_t LPP_BULK_MAX_LAYOUTS = 16;
+
+    /**
+     * @brief One uplink to decode.
+     */
+    struct LppFrame
+    {
+        uint32_t device;        /**< Device identifier chosen by the caller, e.g. an index into a DevEUI table. */
+        const uint8_t *data;    /**< The LPP payload. */
+        uint16_t size;          /**< Size of the payload in bytes. */
+    };
+
+    /**
+     * @brief All samples of one (device, channel, type), stored column-wise.
+     */
+    struct LppColumn
+    {
+        uint32_t device;                    /**< Device identifier. */
+        uint8_t channel;                    /**< LPP channel. */
+        DATA_TYPES type;                    /**< LPP data type. */
+        uint8_t valueCount;                 /**< Values per sample: 1, or 3 for xyz and GPS types. */
+        std::vector<uint32_t> frames;       /**< Index of the source frame of every sample. */
+        std::vector<int32_t> values[3];     /**< Scaled values, one vector per axis. */
+    };
+
+    /**
+     * @brief Collection of columns with a lookup by (device, channel, type).
+     */
+    class LppColumnStore
+    {
+    public:
+        /**
+         * @brief Finds or creates the column of a (device, channel, type).
+         *
+         * @return size_t Index of the column, stays valid while the store exists.
+         */
+        size_t columnIndex(const uint32_t device, const uint8_t channel, const DATA_TYPES type)
+        {
+            const uint64_t key = (static_cast<uint64_t>(device) << 16) | (static_cast<uint64_t>(channel) << 8) | static_cast<uint8_t>(type);
+            const std::unordered_map<uint64_t, size_t>::const_iterator it = index.find(key);
+            if (it != index.end())
+            {
+                return it->second;
+            }
+            LppColumn column;
+            column.device = device;
+            column.channel = channel;
+            column.type = type;
+            column.valueCount = getDataTypeValueCount(type);
+            index.emplace(key, columns.size());
+            columns.push_back(column);
+            return columns.size() - 1;
+        }
+
+        /**
+         * @brief Gets a column by index.
+         * @return LppColumn& The column.
+         */
+        LppColumn &at(const size_t column)
+        {
+            return columns[column];
+        }
+
+        /**
+         * @brief Appends all samples of another store. Samples keep their order within each column.
+         *
+         * @param other The store to append.
+         */
+        void append(const LppColumnStore &other)
+        {
+            for (const LppColumn &source : other.columns)
+            {
+                LppColumn &target = columns[columnIndex(source.device, source.channel, source.type)];
+                target.frames.insert(target.frames.end(), source.frames.begin(), source.frames.end());
+                for (uint8_t axis = 0; axis < source.valueCount; axis++)
+                {
+                    target.values[axis].insert(target.values[axis].end(), source.values[axis].begin(), source.values[axis].end());
+                }
+            }
+        }
+
+        /**
+         * @brief Gets all columns, in order of first appearance.
+         * @return const std::vector<LppColumn>& The columns.
+         */
+        const std::vector<LppColumn> &getColumns() const
+        {
+            return columns;
+        }
+
+        /**
+         * @brief Counts the samples in all columns.
+         * @return size_t Number of samples.
+         */
+        size_t sampleCount() const
+        {
+            size_t count = 0;
+            for (const LppColumn &column : columns)
+            {
+                count += column.frames.size();
+            }
+            return count;
+        }
+
+    private:
+        std::unordered_map<uint64_t, size_t> index;
+        std::vector<LppColumn> columns;
+    };
+
+    /**
+     * @brief A learned frame layout with the tables for the fast path.
+     */
+    struct LppLayout
+    {
+        uint8_t pattern[LPP_BULK_MAX_FRAME];                   /**< Header bytes at their offsets, 0 elsewhere. */
+        uint8_t mask[LPP_BULK_MAX_FRAME];                      /**< 0xFF at header offsets, 0 elsewhere. */
+        uint8_t shuffle[4][2 * LPP_BULK_MAX_VALUES];           /**< Per 16-byte input chunk: source byte of every output byte, 0x80 for none. */
+        int32_t signMask[LPP_BULK_MAX_VALUES];                 /**< -1 for values that are sign extended. */
+        uint8_t sourceLow[LPP_BULK_MAX_VALUES];                 /**< Scalar version of shuffle: offset of the low byte. */
+        uint8_t sourceHigh[LPP_BULK_MAX_VALUES];                /**< Offset of the high byte, 0xFF for 1-byte values. */
+        uint8_t fieldChannel[LPP_BULK_MAX_VALUES];
+        DATA_TYPES fieldType[LPP_BULK_MAX_VALUES];
+        uint8_t fieldValues[LPP_BULK_MAX_VALUES];               /**< Number of values of every field. */
+        uint8_t size;                                           /**< Frame size in bytes. */
+        uint8_t chunkCount;                                     /**< Number of 16-byte input chunks. */
+        uint8_t fieldCount;
+        uint8_t valueCount;
+        uint32_t cachedDevice;                                  /**< Device of cachedColumns, valid for one decode() call. */
+        bool cacheValid;
+        size_t cachedColumns[LPP_BULK_MAX_VALUES];              /**< Column index of every field for cachedDevice. */
+    };
+
+    /**
+     * @brief Single threaded batch decoder. Use one decoder per thread, or decodeLppParallel().
+     */
+    class LppBulkDecoder
+    {
+    public:
+        /**
+         * @brief Constructor for LppBulkDecoder.
+         *
+         * @param format The wire format of all frames.
+         */
+        explicit LppBulkDecoder(const LPP_FORMAT format = LPP_FORMAT::ENCODER)
+            : format(format), fastPath(true), lastLayout(0), fastFrames(0), scalarFrames(0), invalidFrames(0)
+        {
+            layouts.reserve(LPP_BULK_MAX_LAYOUTS);
+        }
+
+        /**
+         * @brief Enables or disables the fixed-layout fast path, e.g. to compare both paths.
+         * @param enabled Set to false to decode every frame with CayenneLPPView.
+         */
+        void setFastPath(const bool enabled)
+        {
+            fastPath = enabled;
+        }
+
+        /**
+         * @brief Decodes a batch of frames into the store.
+         *
+         * @param frames The frames.
+         * @param count Number of frames.
+         * @param store Receives the samples.
+         * @param firstIndex Frame index stored for frames[0], so batches can be numbered globally.
+         * @return size_t Number of frames that were decoded; invalid frames are skipped.
+         */
+        size_t decode(const LppFrame *frames, const size_t count, LppColumnStore &store, const uint32_t firstIndex = 0)
+        {
+            uint8_t padded[LPP_BULK_MAX_FRAME];
+            int32_t values[LPP_BULK_MAX_VALUES];
+            size_t decoded = 0;
+            for (LppLayout &layout : layouts)
+            {
+                layout.cacheValid = false; // the cached column indices belong to the store of the previous call
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                const LppFrame &frame = frames[i];
+                const uint32_t frameIndex = firstIndex + static_cast<uint32_t>(i);
+                LppLayout *layout = nullptr;
+                if (fastPath && frame.size > 0 && frame.size <= LPP_BULK_MAX_FRAME)
+                {
+                    memcpy(padded, frame.data, frame.size);
+                    memset(padded + frame.size, 0, LPP_BULK_MAX_FRAME - frame.size);
+                    layout = findLayout(padded, frame.size);
+                }
+                if (layout)
+                {
+                    extractValues(*layout, padded, values);
+                    storeValues(*layout, frame.device, frameIndex, values, store);
+                    fastFrames++;
+                    decoded++;
+                }
+                else if (decodeScalar(frame, frameIndex, store))
+                {
+                    scalarFrames++;
+                    decoded++;
+                }
+                else
+                {
+                    invalidFrames++;
+                }
+            }
+            return decoded;
+        }
+
+        /** @brief Number of frames decoded on the fast path. */
+        size_t getFastFrames() const { return fastFrames; }
+
+        /** @brief Number of frames decoded with CayenneLPPView. */
+        size_t getScalarFrames() const { return scalarFrames; }
+
+        /** @brief Number of frames skipped because they are not valid LPP. */
+        size_t getInvalidFrames() const { return invalidFrames; }
+
+    private:
+        LPP_FORMAT format;
+        bool fastPath;
+        size_t lastLayout;
+        size_t fastFrames;
+        size_t scalarFrames;
+        size_t invalidFrames;
+        std::vector<LppLayout> layouts;
+
+        /**
+         * @brief Checks whether the header bytes of a frame match a layout.
+         *
+         * @param layout The layout.
+         * @param frame The zero padded frame.
+         * @return bool True if all header bytes match.
+         */
+        static bool matches(const LppLayout &layout, const uint8_t *frame)
+        {
+#if defined(__AVX2__)
+            for (size_t i = 0; i < LPP_BULK_MAX_FRAME; i += 32)
+            {
+                const __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frame + i)),
+                                                      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layout.pattern + i)));
+                if (!_mm256_testz_si256(diff, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layout.mask + i))))
+                {
+                    return false;
+                }
+            }
+            return true;
+#elif defined(__SSE4_1__)
+            for (size_t i = 0; i < LPP_BULK_MAX_FRAME; i += 16)
+            {
+                const __m128i diff = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i)),
+                                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(layout.pattern + i)));
+                if (!_mm_testz_si128(diff, _mm_loadu_si128(reinterpret_cast<const __m128i *>(layout.mask + i))))
+                {
+                    return false;
+                }
+            }
+            return true;
+#else
+            for (size_t i = 0; i < layout.size; i++)
+            {
+                if ((frame[i] ^ layout.pattern[i]) & layout.mask[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+#endif
+        }
+
+        /**
+         * @brief Gathers all values of a frame into int32 lanes.
+         *
+         * @param layout The layout of the frame.
+         * @param frame The zero padded frame.
+         * @param values Receives layout.valueCount scaled values.
+         */
+        static void extractValues(const LppLayout &layout, const uint8_t *frame, int32_t *values)
+        {
+#if defined(__AVX2__)
+            const size_t vectors = (layout.valueCount + 15) / 16;
+            for (size_t v = 0; v < vectors; v++)
+            {
+                __m256i lanes = _mm256_setzero_si256();
+                for (size_t k = 0; k < layout.chunkCount; k++)
+                {
+                    const __m256i chunk = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + 16 * k)));
+                    const __m256i control = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layout.shuffle[k] + 32 * v));
+                    lanes = _mm256_or_si256(lanes, _mm256_shuffle_epi8(chunk, control));
+                }
+                for (size_t half = 0; half < 2; half++)
+                {
+                    const __m128i words = half ? _mm256_extracti128_si256(lanes, 1) : _mm256_castsi256_si128(lanes);
+                    const __m256i sign = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(layout.signMask + 16 * v + 8 * half));
+                    const __m256i wide = _mm256_blendv_epi8(_mm256_cvtepu16_epi32(words), _mm256_cvtepi16_epi32(words), sign);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + 16 * v + 8 * half), wide);
+                }
+            }
+#elif defined(__SSE4_1__)
+            const size_t vectors = (layout.valueCount + 7) / 8;
+            for (size_t v = 0; v < vectors; v++)
+            {
+                __m128i lanes = _mm_setzero_si128();
+                for (size_t k = 0; k < layout.chunkCount; k++)
+                {
+                    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + 16 * k));
+                    const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layout.shuffle[k] + 16 * v));
+                    lanes = _mm_or_si128(lanes, _mm_shuffle_epi8(chunk, control));
+                }
+                for (size_t half = 0; half < 2; half++)
+                {
+                    const __m128i words = half ? _mm_srli_si128(lanes, 8) : lanes;
+                    const __m128i sign = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layout.signMask + 8 * v + 4 * half));
+                    const __m128i wide = _mm_blendv_epi8(_mm_cvtepu16_epi32(words), _mm_cvtepi16_epi32(words), sign);
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 8 * v + 4 * half), wide);
+                }
+            }
+#else
+            for (size_t v = 0; v < layout.valueCount; v++)
+            {
+                const uint16_t word = frame[layout.sourceLow[v]] |
+                                      (layout.sourceHigh[v] != 0xFF ? static_cast<uint16_t>(frame[layout.sourceHigh[v]]) << 8 : 0);
+                values[v] = layout.signMask[v] ? static_cast<int32_t>(static_cast<int16_t>(word)) : static_cast<int32_t>(word);
+            }
+#endif
+        }
+
+        /**
+         * @brief Appends the values of a fast path frame to their columns.
+         */
+        static void storeValues(LppLayout &layout, const uint32_t device, const uint32_t frameIndex, const int32_t *values, LppColumnStore &store)
+        {
+            if (!layout.cacheValid || layout.cachedDevice != device)
+            {
+                for (size_t f = 0; f < layout.fieldCount; f++)
+                {
+                    layout.cachedColumns[f] = store.columnIndex(device, layout.fieldChannel[f], layout.fieldType[f]);
+                }
+                layout.cachedDevice = device;
+                layout.cacheValid = true;
+            }
+            size_t v = 0;
+            for (size_t f = 0; f < layout.fieldCount; f++)
+            {
+                LppColumn &column = store.at(layout.cachedColumns[f]);
+                column.frames.push_back(frameIndex);
+                for (uint8_t axis = 0; axis < layout.fieldValues[f]; axis++)
+                {
+                    column.values[axis].push_back(values[v++]);
+                }
+            }
+        }
+
+        /**
+         * @brief Finds the layout of a frame, learning it when it is new.
+         *
+         * @param frame The zero padded frame.
+         * @param size The size of the frame.
+         * @return LppLayout* The layout, or nullptr if the frame cannot take the fast path.
+         */
+        LppLayout *findLayout(const uint8_t *frame, const size_t size)
+        {
+            if (lastLayout < layouts.size() && layouts[lastLayout].size == size && matches(layouts[lastLayout], frame))
+            {
+                return &layouts[lastLayout];
+            }
+            for (size_t i = 0; i < layouts.size(); i++)
+            {
+                if (layouts[i].size == size && matches(layouts[i], frame))
+                {
+                    lastLayout = i;
+                    return &layouts[i];
+                }
+            }
+            if (layouts.size() >= LPP_BULK_MAX_LAYOUTS)
+            {
+                return nullptr;
+            }
+            layouts.emplace_back();
+            if (!learnLayout(frame, size, layouts.back()))
+            {
+                layouts.pop_back(); // e.g. GPS: keep trying, a later frame may have a layout that fits
+                return nullptr;
+            }
+            lastLayout = layouts.size() - 1;
+            return &layouts.back();
+        }
+
+        /**
+         * @brief Builds the fast path tables for the layout of a frame.
+         *
+         * @param frame The frame.
+         * @param size The size of the frame.
+         * @param layout Receives the layout.
+         * @return bool False if the frame is invalid or has values the fast path does not handle.
+         */
+        bool learnLayout(const uint8_t *frame, const size_t size, LppLayout &layout) const
+        {
+            const CayenneLPPView view(frame, size, format);
+            if (view.validate() != ERROR_TYPES::LPP_ERROR_OK)
+            {
+                return false;
+            }
+            memset(layout.pattern, 0, sizeof(layout.pattern));
+            memset(layout.mask, 0, sizeof(layout.mask));
+            memset(layout.shuffle, 0x80, sizeof(layout.shuffle));
+            memset(layout.signMask, 0, sizeof(layout.signMask));
+            layout.size = static_cast<uint8_t>(size);
+            layout.chunkCount = static_cast<uint8_t>((size + 15) / 16);
+            layout.fieldCount = 0;
+            layout.valueCount = 0;
+            layout.cacheValid = false;
+
+            for (const CayenneField &field : view)
+            {
+                const size_t offset = static_cast<size_t>(field.bytes() - frame);
+                const uint8_t width = field.size() / field.count();
+                const bool isSigned = isDataTypeSigned(field.type());
+                if (width > 2 || (width == 1 && isSigned) || getDataTypeScale(field.type(), format) != 1 ||
+                    layout.valueCount + field.count() > LPP_BULK_MAX_VALUES)
+                {
+                    return false;
+                }
+                layout.pattern[offset - 2] = frame[offset - 2];
+                layout.pattern[offset - 1] = frame[offset - 1];
+                layout.mask[offset - 2] = 0xFF;
+                layout.mask[offset - 1] = 0xFF;
+                layout.fieldChannel[layout.fieldCount] = field.channel();
+                layout.fieldType[layout.fieldCount] = field.type();
+                layout.fieldValues[layout.fieldCount] = field.count();
+                layout.fieldCount++;
+
+                for (uint8_t axis = 0; axis < field.count(); axis++)
+                {
+                    const uint8_t v = layout.valueCount++;
+                    const size_t base = offset + axis * width;
+                    const bool bigEndian = format == LPP_FORMAT::STANDARD;
+                    const size_t low = (width == 2 && bigEndian) ? base + 1 : base;
+                    layout.sourceLow[v] = static_cast<uint8_t>(low);
+                    layout.shuffle[low / 16][2 * v] = low % 16;
+                    layout.sourceHigh[v] = 0xFF;
+                    if (width == 2)
+                    {
+                        const size_t high = bigEndian ? base : base + 1;
+                        layout.sourceHigh[v] = static_cast<uint8_t>(high);
+                        layout.shuffle[high / 16][2 * v + 1] = high % 16;
+                    }
+                    layout.signMask[v] = (width == 2 && isSigned) ? -1 : 0;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Decodes a frame with CayenneLPPView.
+         *
+         * @return bool False if the frame is not valid LPP.
+         */
+        bool decodeScalar(const LppFrame &frame, const uint32_t frameIndex, LppColumnStore &store) const
+        {
+            const CayenneLPPView view(frame.data, frame.size, format);
+            if (frame.size == 0 || view.validate() != ERROR_TYPES::LPP_ERROR_OK)
+            {
+                return false;
+            }
+            for (const CayenneField &field : view)
+            {
+                LppColumn &column = store.at(store.columnIndex(frame.device, field.channel(), field.type()));
+                column.frames.push_back(frameIndex);
+                for (uint8_t axis = 0; axis < field.count(); axis++)
+                {
+                    column.values[axis].push_back(field.scaledValue(axis));
+                }
+            }
+            return true;
+        }
+    }; // End of class LppBulkDecoder.
+
+    /**
+     * @brief Decodes a batch of frames on several threads.
+     *
+     * The batch is split into one contiguous range per thread. Every thread decodes into its own store, and
+     * the stores are appended in range order, so samples stay in frame order within every column.
+     *
+     * @param frames The frames.
+     * @param count Number of frames.
+     * @param store Receives the samples.
+     * @param format The wire format of all frames.
+     * @param threads Number of threads, 0 for one per core.
+     * @return size_t Number of frames that were decoded.
+     */
+    static inline size_t decodeLppParallel(const LppFrame *frames, const size_t count, LppColumnStore &store,
+                                           const LPP_FORMAT format = LPP_FORMAT::ENCODER, unsigned threads = 0)
+    {
+        if (threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+        }
+        if (threads == 0)
+        {
+            threads = 1;
+        }
+        if (threads > count)
+        {
+            threads = count > 0 ? static_cast<unsigned>(count) : 1;
+        }
+
+        std::vector<LppColumnStore> partial(threads);
+        std::vector<size_t> decoded(threads, 0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            const size_t begin = count * t / threads;
+            const size_t end = count * (t + 1) / threads;
+            workers.emplace_back([&, t, begin, end]() {
+                LppBulkDecoder decoder(format);
+                decoded[t] = decoder.decode(frames + begin, end - begin, partial[t], static_cast<uint32_t>(begin));
+            });
+        }
+        size_t total = 0;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            workers[t].join();
+            store.append(partial[t]);
+            total += decoded[t];
+        }
+        return total;
+    }
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // LPP_BULK_DECODER_HPP
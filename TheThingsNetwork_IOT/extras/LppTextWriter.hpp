@@ -0,0 +1,477 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef LPP_TEXT_WRITER_HPP
+#define LPP_TEXT_WRITER_HPP
+
+/**
+ * @file LppTextWriter.hpp
+ * @brief Host side conversion of decoded Cayenne LPP frames to JSON Lines or CSV text.
+ *
+ * Values are printed exactly in the resolution of their type: a scaled integer from CayenneField::scaledValue()
+ * (unsignedValue() for unsigned types) gets its decimal point inserted from the power-of-ten column of DATA_TYPE_INFO, so no float conversion or
+ * printf is involved. All formatting writes into a TextBuffer that is reserved once per frame and reused for
+ * the whole run, so steady state decoding does not allocate. Host only: needs the C++ standard library.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "../examples/payloadEncoderTest/CayenneLPPView.hpp"
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Output text formats.
+     */
+    enum class LPP_TEXT_FORMAT : uint8_t
+    {
+        JSON_LINES  = 0,    /**< One JSON object per frame. */
+        CSV         = 1     /**< One row per field: offset,device,channel,type,value0,value1,value2 */
+    };
+
+    /**
+     * @brief Names of the data types, indexed like DATA_TYPE_INFO; nullptr for unknown types.
+     */
+    static const char *const DATA_TYPE_NAMES[DATA_TYPE_INFO_ROWS] =
+    {
+        "digital_input", "digital_output", "analog_input", "analog_output",                        /*   0..3   */
+        "generic", "illumination", "presence", "temperature", "humidity",                           /* 100..104 */
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,                     /* 105..112 */
+        "accelerometer", nullptr, "barometer", "voltage", "current", "frequency", nullptr,          /* 113..119 */
+        "percentage", "altitude", nullptr, nullptr, nullptr, "concentration", nullptr, nullptr,     /* 120..127 */
+        "power", nullptr, "distance", "energy", "direction", "unix_time", "gyrometer", "colour",    /* 128..135 */
+        "gps", nullptr, nullptr, nullptr, nullptr, nullptr, "switch"                                /* 136..142 */
+    };
+
+    /**
+     * @brief Returns the name of a data type.
+     * @param dataType The data type.
+     * @return const char* The name, "unknown" for types without a DATA_TYPE_INFO row.
+     */
+    static inline const char *getDataTypeName(const DATA_TYPES dataType)
+    {
+        const uint8_t row = getDataTypeRow(dataType);
+        return (row < DATA_TYPE_INFO_ROWS && DATA_TYPE_NAMES[row]) ? DATA_TYPE_NAMES[row] : "unknown";
+    }
+
+    /**
+     * @brief Returns the number of decimals of a value, the power of ten of its resolution.
+     * @param dataType The data type.
+     * @param index The value index; the GPS altitude has two decimals less than latitude and longitude.
+     * @return uint8_t The number of decimals.
+     */
+    static inline uint8_t getDataTypeDecimals(const DATA_TYPES dataType, const uint8_t index)
+    {
+        const uint8_t decimals = (getDataTypeInfo(dataType) >> 4) & 0x07;
+        return (dataType == DATA_TYPES::GPS_LOC && index == 2) ? decimals - 2 : decimals;
+    }
+
+    /**
+     * @brief Pairs of decimal digits for the number formatter.
+     */
+    static const char LPP_DIGIT_PAIRS[201] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    /**
+     * @brief Writes an unsigned integer in decimal, two digits per step.
+     *
+     * @param out Destination, needs room for 10 characters.
+     * @param value The value.
+     * @param minDigits Minimum number of digits, padded with leading zeros.
+     * @return char* Pointer past the last written character.
+     */
+    static inline char *formatUnsigned(char *out, uint32_t value, const uint8_t minDigits)
+    {
+        uint8_t length = 1;
+        for (uint32_t rest = value; rest >= 10; rest /= 10)
+        {
+            length++;
+        }
+        if (length < minDigits)
+        {
+            length = minDigits;
+        }
+        char *p = out + length;
+        while (value >= 100)
+        {
+            const uint32_t pair = (value % 100) * 2;
+            value /= 100;
+            *--p = LPP_DIGIT_PAIRS[pair + 1];
+            *--p = LPP_DIGIT_PAIRS[pair];
+        }
+        if (value >= 10)
+        {
+            *--p = LPP_DIGIT_PAIRS[value * 2 + 1];
+            *--p = LPP_DIGIT_PAIRS[value * 2];
+        }
+        else
+        {
+            *--p = static_cast<char>('0' + value);
+        }
+        while (p > out)
+        {
+            *--p = '0';
+        }
+        return out + length;
+    }
+
+    /**
+     * @brief Writes a scaled value with its decimal point, e.g. 215 with 1 decimal as "21.5".
+     *
+     * @param out Destination, needs room for 12 characters.
+     * @param magnitude The absolute scaled value.
+     * @param negative True to prefix a minus sign.
+     * @param decimals Number of decimals (0..4).
+     * @return char* Pointer past the last written character.
+     */
+    static inline char *formatScaled(char *out, const uint32_t magnitude, const bool negative, const uint8_t decimals)
+    {
+        if (negative)
+        {
+            *out++ = '-';
+        }
+        // Constant divisors per case, so the compiler turns them into multiplications.
+        uint32_t integer, fraction;
+        switch (decimals)
+        {
+        case 1:
+            integer = magnitude / 10;
+            fraction = magnitude % 10;
+            break;
+        case 2:
+            integer = magnitude / 100;
+            fraction = magnitude % 100;
+            break;
+        case 3:
+            integer = magnitude / 1000;
+            fraction = magnitude % 1000;
+            break;
+        case 4:
+            integer = magnitude / 10000;
+            fraction = magnitude % 10000;
+            break;
+        default:
+            return formatUnsigned(out, magnitude, 1);
+        }
+        out = formatUnsigned(out, integer, 1);
+        *out++ = '.';
+        return formatUnsigned(out, fraction, decimals);
+    }
+
+    /**
+     * @brief Growable character buffer that keeps its capacity between frames.
+     */
+    class TextBuffer
+    {
+    public:
+        /**
+         * @brief Makes room for at least size more characters.
+         * @param size Number of characters the caller is going to write.
+         * @return char* Write position; pass the new end to commit().
+         */
+        char *reserve(const size_t size)
+        {
+            if (data.size() < used + size)
+            {
+                data.resize((used + size) * 2);
+            }
+            return data.data() + used;
+        }
+
+        /**
+         * @brief Marks the characters up to end as written.
+         * @param end Pointer past the last written character, from within the last reserve().
+         */
+        void commit(const char *end)
+        {
+            used = end - data.data();
+        }
+
+        /**
+         * @brief Empties the buffer, keeping its capacity.
+         */
+        void clear()
+        {
+            used = 0;
+        }
+
+        /**
+         * @brief Returns the text.
+         * @return const char* Pointer to the first character.
+         */
+        const char *text() const
+        {
+            return data.data();
+        }
+
+        /**
+         * @brief Returns the number of written characters.
+         * @return size_t Size of the text.
+         */
+        size_t size() const
+        {
+            return used;
+        }
+
+    private:
+        std::vector<char> data;
+        size_t used = 0;
+    };
+
+    /**
+     * @brief Converts decoded frames to JSON Lines or CSV.
+     *
+     * JSON Lines, one object per frame (3-value types print an array; "error" is only present for
+     * frames that could not be decoded completely):
+     *
+     *     {"offset":0,"device":"0004A30B001C0530","fields":[{"channel":1,"type":"temperature","value":21.5}],"error":"unknown_type"}
+     *
+     * CSV, one row per field: offset,device,channel,type,value0,value1,value2
+     */
+    class LppTextWriter
+    {
+    public:
+        /**
+         * @brief Constructor for LppTextWriter.
+         *
+         * @param textFormat The output format.
+         * @param lppFormat The wire format of the frames.
+         */
+        LppTextWriter(const LPP_TEXT_FORMAT textFormat, const LPP_FORMAT lppFormat = LPP_FORMAT::ENCODER)
+            : textFormat(textFormat), lppFormat(lppFormat), frames(0), fields(0), invalidFrames(0) {}
+
+        /**
+         * @brief Returns the CSV header line, or an empty string for JSON Lines.
+         * @return const char* The header including the line feed.
+         */
+        const char *header() const
+        {
+            return textFormat == LPP_TEXT_FORMAT::CSV ? "offset,device,channel,type,value0,value1,value2\n" : "";
+        }
+
+        /**
+         * @brief Decodes one frame and appends its text to out.
+         *
+         * @param out Receives the text.
+         * @param offset Byte offset of the frame in the input, written to identify the frame.
+         * @param device Device identifier text, may be empty.
+         * @param deviceLength Length of the device identifier.
+         * @param data The LPP payload.
+         * @param size Size of the payload, nullptr data with size 0 marks an unreadable record.
+         */
+        void write(TextBuffer &out, const uint64_t offset, const char *device, const size_t deviceLength,
+            const uint8_t *data, const size_t size)
+        {
+            // Worst case per field: the JSON keys, a 13 character type name and three 12 character values.
+            char *p = out.reserve(96 + 2 * deviceLength + (size / 2 + 1) * (96 + deviceLength));
+            const CayenneLPPView view(data, size, lppFormat);
+            size_t consumed = 0;
+            frames++;
+            if (textFormat == LPP_TEXT_FORMAT::JSON_LINES)
+            {
+                p = appendLiteral(p, "{\"offset\":");
+                p = formatOffset(p, offset);
+                if (deviceLength)
+                {
+                    p = appendLiteral(p, ",\"device\":\"");
+                    p = appendEscaped(p, device, deviceLength);
+                    *p++ = '"';
+                }
+                p = appendLiteral(p, ",\"fields\":[");
+                for (const CayenneField &field : view)
+                {
+                    if (consumed)
+                    {
+                        *p++ = ',';
+                    }
+                    p = appendLiteral(p, "{\"channel\":");
+                    p = formatUnsigned(p, field.channel(), 1);
+                    p = appendLiteral(p, ",\"type\":\"");
+                    p = appendTypeName(p, field.type());
+                    p = appendLiteral(p, "\",\"value\":");
+                    if (field.count() > 1)
+                    {
+                        *p++ = '[';
+                    }
+                    for (uint8_t i = 0; i < field.count(); i++)
+                    {
+                        if (i)
+                        {
+                            *p++ = ',';
+                        }
+                        p = formatValue(p, field, i);
+                    }
+                    if (field.count() > 1)
+                    {
+                        *p++ = ']';
+                    }
+                    *p++ = '}';
+                    consumed += 2 + field.size();
+                    fields++;
+                }
+                *p++ = ']';
+                if (consumed != size || !data)
+                {
+                    p = appendLiteral(p, ",\"error\":\"");
+                    if (!data)
+                    {
+                        p = appendLiteral(p, "bad_record");
+                    }
+                    else if (view.validate() == ERROR_TYPES::LPP_ERROR_UNKOWN_TYPE)
+                    {
+                        p = appendLiteral(p, "unknown_type");
+                    }
+                    else
+                    {
+                        p = appendLiteral(p, "overflow");
+                    }
+                    *p++ = '"';
+                }
+                p = appendLiteral(p, "}\n");
+            }
+            else
+            {
+                for (const CayenneField &field : view)
+                {
+                    p = formatOffset(p, offset);
+                    *p++ = ',';
+                    memcpy(p, device, deviceLength);
+                    p += deviceLength;
+                    *p++ = ',';
+                    p = formatUnsigned(p, field.channel(), 1);
+                    *p++ = ',';
+                    p = appendTypeName(p, field.type());
+                    for (uint8_t i = 0; i < 3; i++)
+                    {
+                        *p++ = ',';
+                        if (i < field.count())
+                        {
+                            p = formatValue(p, field, i);
+                        }
+                    }
+                    *p++ = '\n';
+                    consumed += 2 + field.size();
+                    fields++;
+                }
+            }
+            if (consumed != size || !data)
+            {
+                invalidFrames++;
+            }
+            out.commit(p);
+        }
+
+        /**
+         * @brief Gets the number of frames written.
+         * @return size_t Number of frames.
+         */
+        size_t getFrames() const
+        {
+            return frames;
+        }
+
+        /**
+         * @brief Gets the number of fields written.
+         * @return size_t Number of fields.
+         */
+        size_t getFields() const
+        {
+            return fields;
+        }
+
+        /**
+         * @brief Gets the number of frames that could not be decoded completely.
+         * @return size_t Number of invalid frames.
+         */
+        size_t getInvalidFrames() const
+        {
+            return invalidFrames;
+        }
+
+    private:
+        LPP_TEXT_FORMAT textFormat;
+        LPP_FORMAT lppFormat;
+        size_t frames;
+        size_t fields;
+        size_t invalidFrames;
+
+        /**
+         * @brief Copies a string literal without the terminator; the length is known at compile time.
+         */
+        template <size_t Size>
+        static char *appendLiteral(char *out, const char (&text)[Size])
+        {
+            memcpy(out, text, Size - 1);
+            return out + Size - 1;
+        }
+
+        /**
+         * @brief Copies the name of a data type, see getDataTypeName().
+         */
+        static char *appendTypeName(char *out, const DATA_TYPES dataType)
+        {
+            const char *name = getDataTypeName(dataType);
+            while (*name)
+            {
+                *out++ = *name++;
+            }
+            return out;
+        }
+
+        /**
+         * @brief Copies text into a JSON string, escaping quotes, backslashes and control characters.
+         */
+        static char *appendEscaped(char *out, const char *text, const size_t length)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                const char c = text[i];
+                if (c == '"' || c == '\\')
+                {
+                    *out++ = '\\';
+                    *out++ = c;
+                }
+                else if (static_cast<uint8_t>(c) >= 0x20)
+                {
+                    *out++ = c;
+                }
+            }
+            return out;
+        }
+
+        /**
+         * @brief Writes a 64-bit byte offset.
+         */
+        static char *formatOffset(char *out, const uint64_t offset)
+        {
+            if (offset >= 1000000000ULL)
+            {
+                out = formatUnsigned(out, static_cast<uint32_t>(offset / 1000000000ULL), 1);
+                return formatUnsigned(out, static_cast<uint32_t>(offset % 1000000000ULL), 9);
+            }
+            return formatUnsigned(out, static_cast<uint32_t>(offset), 1);
+        }
+
+        /**
+         * @brief Writes one value of a field in the resolution of its type.
+         */
+        static char *formatValue(char *out, const CayenneField &field, const uint8_t index)
+        {
+            const uint8_t decimals = getDataTypeDecimals(field.type(), index);
+            if (isDataTypeSigned(field.type()) && field.scaledValue(index) < 0)
+            {
+                return formatScaled(out, 0U - static_cast<uint32_t>(field.scaledValue(index)), true, decimals);
+            }
+            return formatScaled(out, field.unsignedValue(index), false, decimals);
+        }
+    }; // End of class LppTextWriter.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // LPP_TEXT_WRITER_HPP
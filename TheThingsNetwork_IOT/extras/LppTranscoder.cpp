@@ -0,0 +1,379 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+/**
+ * @file LppTranscoder.cpp
+ * @brief Command line tool that converts uplink dumps with Cayenne LPP payloads to JSON Lines or CSV.
+ *
+ * Build (from this directory, POSIX host):
+ *
+ *     g++ -O2 -std=c++11 -pthread LppTranscoder.cpp -o lpp_transcode
+ *
+ * Usage: lpp_transcode [--hex | --binary] [--json | --csv] [--standard] [--threads N] [-o output] input
+ *
+ * Input formats:
+ *  - hex (default): one uplink per line, "payload" or "device,payload" with the payload in hex digits;
+ *  - binary: records of one length byte followed by that many payload bytes.
+ *
+ * The input is memory-mapped and cut into blocks of LPP_TRANSCODE_BLOCK bytes at record boundaries. One
+ * worker per core converts blocks into its own reusable text buffer; the main thread writes the buffers
+ * in input order, so the output does not depend on the number of threads. Frames are identified by
+ * their byte offset in the input. A summary with the throughput goes to stderr.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LppTextWriter.hpp"
+
+using namespace PAYLOAD_ENCODER;
+
+/**
+ * @brief Target size of one block of input, in bytes.
+ */
+static const size_t LPP_TRANSCODE_BLOCK = 4 * 1024 * 1024;
+
+/**
+ * @brief Number of blocks per worker that may be converted ahead of the writer.
+ */
+static const size_t LPP_TRANSCODE_AHEAD = 2;
+
+/**
+ * @brief Largest payload of one record, the LoRaWAN maximum.
+ */
+static const size_t LPP_TRANSCODE_MAX_PAYLOAD = 255;
+
+/**
+ * @brief Input record formats.
+ */
+enum class INPUT_FORMAT : uint8_t
+{
+    HEX     = 0,
+    BINARY  = 1
+};
+
+/**
+ * @brief Value of every hex digit character, 0xFF for other characters.
+ */
+struct HexTable
+{
+    uint8_t value[256];
+
+    HexTable()
+    {
+        memset(value, 0xFF, sizeof(value));
+        for (uint8_t i = 0; i < 10; i++)
+        {
+            value['0' + i] = i;
+        }
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            value['a' + i] = 10 + i;
+            value['A' + i] = 10 + i;
+        }
+    }
+};
+
+static const HexTable hexTable;
+
+/**
+ * @brief Converts hex digits to bytes.
+ *
+ * @param text The hex digits.
+ * @param length Number of digits.
+ * @param out Receives length / 2 bytes.
+ * @return bool False for an odd length or a character that is not a hex digit.
+ */
+static bool decodeHex(const char *text, const size_t length, uint8_t *out)
+{
+    if (length & 1)
+    {
+        return false;
+    }
+    uint8_t bad = 0;
+    for (size_t i = 0; i < length; i += 2)
+    {
+        const uint8_t high = hexTable.value[static_cast<uint8_t>(text[i])];
+        const uint8_t low = hexTable.value[static_cast<uint8_t>(text[i + 1])];
+        bad |= high | low;
+        out[i / 2] = static_cast<uint8_t>((high << 4) | (low & 0x0F));
+    }
+    return !(bad & 0xF0);
+}
+
+/**
+ * @brief Byte range of one block of input.
+ */
+struct Block
+{
+    size_t begin;       /**< Offset of the first record. */
+    size_t end;         /**< Offset past the last record. */
+};
+
+/**
+ * @brief Cuts the input into blocks that start and end at record boundaries.
+ */
+static std::vector<Block> splitBlocks(const char *input, const size_t size, const INPUT_FORMAT format)
+{
+    std::vector<Block> blocks;
+    size_t begin = 0;
+    while (begin < size)
+    {
+        size_t end = begin + LPP_TRANSCODE_BLOCK;
+        if (end >= size)
+        {
+            end = size;
+        }
+        else if (format == INPUT_FORMAT::HEX)
+        {
+            const char *newline = static_cast<const char *>(memchr(input + end, '\n', size - end));
+            end = newline ? newline - input + 1 : size;
+        }
+        else
+        {
+            // Records can only be found from the start of the block, so walk the length bytes.
+            end = begin;
+            while (end < size && end - begin < LPP_TRANSCODE_BLOCK)
+            {
+                end += 1 + static_cast<uint8_t>(input[end]);
+            }
+            if (end > size)
+            {
+                end = size;
+            }
+        }
+        blocks.push_back(Block{begin, end});
+        begin = end;
+    }
+    return blocks;
+}
+
+/**
+ * @brief Converts all records of one block.
+ */
+static void convertBlock(const char *input, const Block &block, const INPUT_FORMAT format, LppTextWriter &writer, TextBuffer &out)
+{
+    uint8_t payload[LPP_TRANSCODE_MAX_PAYLOAD];
+    size_t offset = block.begin;
+    while (offset < block.end)
+    {
+        if (format == INPUT_FORMAT::BINARY)
+        {
+            const size_t length = static_cast<uint8_t>(input[offset]);
+            if (offset + 1 + length > block.end)
+            {
+                writer.write(out, offset, "", 0, nullptr, 0); // truncated last record
+                break;
+            }
+            writer.write(out, offset, "", 0, reinterpret_cast<const uint8_t *>(input + offset + 1), length);
+            offset += 1 + length;
+            continue;
+        }
+
+        const char *line = input + offset;
+        const char *newline = static_cast<const char *>(memchr(line, '\n', block.end - offset));
+        size_t length = newline ? newline - line : block.end - offset;
+        const size_t next = offset + length + 1;
+        if (length && line[length - 1] == '\r')
+        {
+            length--;
+        }
+        if (length == 0)
+        {
+            offset = next;
+            continue;
+        }
+        const char *separator = static_cast<const char *>(memchr(line, ',', length));
+        const char *hex = separator ? separator + 1 : line;
+        const size_t deviceLength = separator ? separator - line : 0;
+        const size_t hexLength = line + length - hex;
+        if (hexLength / 2 <= LPP_TRANSCODE_MAX_PAYLOAD && decodeHex(hex, hexLength, payload))
+        {
+            writer.write(out, offset, line, deviceLength, payload, hexLength / 2);
+        }
+        else
+        {
+            writer.write(out, offset, line, deviceLength, nullptr, 0);
+        }
+        offset = next;
+    }
+}
+
+/**
+ * @brief Prints the usage and returns the exit code for bad arguments.
+ */
+static int usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--hex | --binary] [--json | --csv] [--standard] [--threads N] [-o output] input\n", program);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    INPUT_FORMAT inputFormat = INPUT_FORMAT::HEX;
+    LPP_TEXT_FORMAT textFormat = LPP_TEXT_FORMAT::JSON_LINES;
+    LPP_FORMAT lppFormat = LPP_FORMAT::ENCODER;
+    unsigned threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    const char *inputName = nullptr;
+    const char *outputName = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--hex"))
+        {
+            inputFormat = INPUT_FORMAT::HEX;
+        }
+        else if (!strcmp(argv[i], "--binary"))
+        {
+            inputFormat = INPUT_FORMAT::BINARY;
+        }
+        else if (!strcmp(argv[i], "--json"))
+        {
+            textFormat = LPP_TEXT_FORMAT::JSON_LINES;
+        }
+        else if (!strcmp(argv[i], "--csv"))
+        {
+            textFormat = LPP_TEXT_FORMAT::CSV;
+        }
+        else if (!strcmp(argv[i], "--standard"))
+        {
+            lppFormat = LPP_FORMAT::STANDARD;
+        }
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        {
+            threads = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+        {
+            outputName = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !inputName)
+        {
+            inputName = argv[i];
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (!inputName || threads == 0)
+    {
+        return usage(argv[0]);
+    }
+
+    const int fd = open(inputName, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        perror(inputName);
+        return 1;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    const char *input = "";
+    if (size > 0)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            perror(inputName);
+            return 1;
+        }
+        madvise(mapping, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+        input = static_cast<const char *>(mapping);
+    }
+    FILE *output = outputName ? fopen(outputName, "wb") : stdout;
+    if (!output)
+    {
+        perror(outputName);
+        return 1;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::vector<Block> blocks = splitBlocks(input, size, inputFormat);
+    const size_t slots = threads * LPP_TRANSCODE_AHEAD;
+    std::vector<TextBuffer> buffers(slots);
+    std::vector<uint8_t> done(blocks.size(), 0);
+    std::atomic<size_t> nextBlock(0);
+    size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<LppTextWriter> writers(threads, LppTextWriter(textFormat, lppFormat));
+
+    // Workers take the next block, wait until its buffer slot has been written out and fill it.
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+        {
+            for (size_t index = nextBlock++; index < blocks.size(); index = nextBlock++)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() { return index < written + slots; });
+                }
+                TextBuffer &buffer = buffers[index % slots];
+                buffer.clear();
+                convertBlock(input, blocks[index], inputFormat, writers[t], buffer);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done[index] = 1;
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    fputs(writers[0].header(), output);
+    bool writeFailed = false;
+    while (written < blocks.size())
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return done[written] != 0; });
+        }
+        const TextBuffer &buffer = buffers[written % slots];
+        writeFailed |= fwrite(buffer.text(), 1, buffer.size(), output) != buffer.size();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written++;
+        }
+        changed.notify_all();
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    writeFailed |= fflush(output) != 0;
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t frames = 0, fields = 0, invalid = 0;
+    for (const LppTextWriter &writer : writers)
+    {
+        frames += writer.getFrames();
+        fields += writer.getFields();
+        invalid += writer.getInvalidFrames();
+    }
+    fprintf(stderr, "%zu frames, %zu fields, %zu invalid, %zu bytes in %.3f s (%.0f MB/s, %u threads)\n",
+        frames, fields, invalid, size, seconds, size / seconds / 1e6, threads);
+    if (outputName)
+    {
+        fclose(output);
+    }
+    if (writeFailed)
+    {
+        perror(outputName ? outputName : "stdout");
+        return 1;
+    }
+    return 0;
+}
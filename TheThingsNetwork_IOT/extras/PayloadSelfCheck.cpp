@@ -0,0 +1,248 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+/**
+ * @file PayloadSelfCheck.cpp
+ * @brief Host self check for the payload helpers of the example that no sketch exercises yet.
+ *
+ * Build and run (from this directory):
+ *
+ *     g++ -O2 -std=c++11 PayloadSelfCheck.cpp -o payload_self_check && ./payload_self_check
+ *
+ * Covers the paths that only run when buffers fill up: the rollover of FramePool::append() into a new
+ * frame, the rollback and deadline eviction of PriorityPacker, the drop counting of a full EventRing and
+ * a TimeSeriesEncoder/TimeSeriesView round trip. Also decodes with one LppBulkDecoder into two stores and
+ * reads an unsigned 4-byte value above INT32_MAX back through CayenneLPPView.
+ * Prints one line per helper and returns 2 on a mismatch.
+ */
+
+#include <cstdio>
+#include "../examples/payloadEncoderTest/CayenneLPP.hpp"
+#include "../examples/payloadEncoderTest/CayenneLPPView.hpp"
+#include "../examples/payloadEncoderTest/EventRing.hpp"
+#include "../examples/payloadEncoderTest/FramePool.hpp"
+#include "../examples/payloadEncoderTest/PriorityPacker.hpp"
+#include "../examples/payloadEncoderTest/TimeSeries.hpp"
+#include "LppBulkDecoder.hpp"
+
+using namespace PAYLOAD_ENCODER;
+
+/**
+ * @brief Fills a pool of two 12-byte frames with 4-byte temperature fields through append().
+ *
+ * The fourth field rolls over into the second frame, the seventh finds no free frame. Frames are taken
+ * in commit order.
+ */
+static bool framePoolOk()
+{
+    FramePool<51, 2> pool(12);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if (pool.append([i](CayenneLPP<51> &lpp) { return lpp.addTemperature(i, FixedPoint(200 + i)); }) != 4 * (i + 1))
+        {
+            return false;
+        }
+    }
+    if (pool.getReadyCount() != 0)
+    {
+        return false;
+    }
+    // Rollover: the current frame is full, so it is committed and the field goes into the other frame.
+    if (pool.append([](CayenneLPP<51> &lpp) { return lpp.addTemperature(3, FixedPoint(203)); }) != 4 || pool.getReadyCount() != 1)
+    {
+        return false;
+    }
+    for (uint8_t i = 4; i < 6; i++)
+    {
+        pool.append([i](CayenneLPP<51> &lpp) { return lpp.addTemperature(i, FixedPoint(200 + i)); });
+    }
+    // Both frames are taken now: the full one is committed but no frame is free for the field.
+    if (pool.append([](CayenneLPP<51> &lpp) { return lpp.addTemperature(6, FixedPoint(206)); }) != 0 || pool.getReadyCount() != 2)
+    {
+        return false;
+    }
+
+    CayenneLPP<51> *first = pool.take();
+    CayenneLPP<51> *second = pool.take();
+    if (!first || !second || pool.take() != nullptr || first->getSize() != 12 || first->getBuffer()[1] != 0 || second->getBuffer()[1] != 3)
+    {
+        return false;
+    }
+    return pool.release(first) && pool.release(second) && !pool.release(first);
+}
+
+/**
+ * @brief Packs queued fields into frames too small for all of them.
+ *
+ * An accelerometer field (8 bytes) with the highest priority does not fit next to the critical presence
+ * field (3 bytes) in a 10-byte frame, so it is rolled back and the smaller fields fill the frame; it goes
+ * out in the next frame. A field past its deadline is dropped, and a full queue pushes out its lowest
+ * priority field.
+ */
+static bool priorityPackerOk()
+{
+    PriorityPacker<4> packer;
+    packer.queue(DATA_TYPES::PRSNC_SENS, 6, FixedPoint(1), FIELD_PRIORITY_CRITICAL, 0);
+    packer.queue(DATA_TYPES::ACCRM_SENS, 4, FixedPoint(10), FixedPoint(-20), FixedPoint(1000), 200, 1000);
+    packer.queue(DATA_TYPES::TEMP_SENS, 1, FixedPoint(215), 100, 1000);
+    packer.queue(DATA_TYPES::HUM_SENS, 2, FixedPoint(500), 50, 100);
+
+    // The queue is full: a more important field pushes out the humidity, a less important one is refused.
+    if (!packer.queue(DATA_TYPES::ILLUM_SENS, 3, FixedPoint(300), 60, 1000) || packer.queue(DATA_TYPES::VOLT_SENS, 7, FixedPoint(330), 10, 1000) ||
+        packer.getDroppedCount() != 1)
+    {
+        return false;
+    }
+
+    CayenneLPP<51> lpp(10);
+    // Presence (3 bytes) and temperature (4) fit; the accelerometer (8) and then the illumination (4) would
+    // not, so both are rolled back.
+    if (packer.pack(lpp, 500) != 7 || packer.getPendingCount() != 2 || lpp.getBuffer()[1] != 6 || lpp.getBuffer()[4] != 1)
+    {
+        return false;
+    }
+
+    CayenneLPP<51> next(51);
+    if (packer.pack(next, 600) != 12 || next.getBuffer()[1] != 4 || packer.getPendingCount() != 0)
+    {
+        return false;
+    }
+
+    // Deadline eviction: the temperature is stale by the time the next frame is packed.
+    CayenneLPP<51> late(51);
+    packer.queue(DATA_TYPES::TEMP_SENS, 1, FixedPoint(216), 100, 1000);
+    packer.queue(DATA_TYPES::PRSNC_SENS, 6, FixedPoint(0), FIELD_PRIORITY_CRITICAL, 1000);
+    return packer.pack(late, 2000) == 3 && packer.getDroppedCount() == 2 && packer.getPendingCount() == 0;
+}
+
+/**
+ * @brief Posts one event more than the ring holds and checks the order and the drop count.
+ */
+static bool eventRingOk()
+{
+    EventRing<uint8_t, 4> ring;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (!ring.post(i))
+        {
+            return false;
+        }
+    }
+    if (ring.post(4) || ring.getDroppedCount() != 1)
+    {
+        return false;
+    }
+    uint8_t event = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (!ring.take(event) || event != i)
+        {
+            return false;
+        }
+    }
+    return !ring.take(event) && ring.isEmpty() && ring.post(5) && ring.take(event) && event == 5;
+}
+
+/**
+ * @brief Encodes a temperature series and decodes it again against the uplink receive time.
+ */
+static bool timeSeriesOk()
+{
+    static const uint32_t times[] = {1000, 1060, 1120, 1300};
+    static const int32_t values[] = {215, 217, 210, -5};
+    TimeSeriesEncoder<51> series(51);
+    series.reset(DATA_TYPES::TEMP_SENS, 1);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (series.addScaledSample(times[i], values[i]) == 0)
+        {
+            return false;
+        }
+    }
+    if (series.addScaledSample(1200, 0) != 0) // older than the previous sample
+    {
+        return false;
+    }
+    series.finalize(1330);
+
+    const TimeSeriesView view(series.getBuffer(), series.getSize());
+    TimeSeriesSample samples[4];
+    if (view.type() != DATA_TYPES::TEMP_SENS || view.channel() != 1 || view.decode(50030, samples, 4) != 4)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (samples[i].timestamp != times[i] + 48700 || samples[i].scaledValue != values[i])
+        {
+            return false;
+        }
+    }
+    return view.decode(50030, samples, 3) == 0;
+}
+
+/**
+ * @brief Decodes the same layout and device with one decoder into two stores.
+ *
+ * The first store has more columns than the second, so column indices cached for the first store do not
+ * exist in the second one.
+ */
+static bool bulkDecoderReuseOk()
+{
+    CayenneLPP<51> lpp(51);
+    lpp.addTemperature(1, FixedPoint(215));
+    lpp.addHumidity(2, FixedPoint(500));
+    const LppFrame first[] = {{1, lpp.getBuffer(), lpp.getSize()}, {2, lpp.getBuffer(), lpp.getSize()}};
+    const LppFrame second = {2, lpp.getBuffer(), lpp.getSize()};
+    LppBulkDecoder decoder;
+    LppColumnStore s1;
+    LppColumnStore s2;
+    if (decoder.decode(first, 2, s1) != 2 || decoder.decode(&second, 1, s2, 2) != 1 || decoder.getFastFrames() != 3)
+    {
+        return false;
+    }
+    if (s1.getColumns().size() != 4 || s1.sampleCount() != 4 || s2.getColumns().size() != 2 || s2.sampleCount() != 2)
+    {
+        return false;
+    }
+    const LppColumn &temperature = s2.getColumns()[0];
+    const LppColumn &humidity = s2.getColumns()[1];
+    return temperature.device == 2 && temperature.frames[0] == 2 && temperature.values[0][0] == 215 &&
+           humidity.device == 2 && humidity.values[0][0] == 500;
+}
+
+/**
+ * @brief Reads a unix time after 2038 back; it does not fit in the int32_t of scaledValue().
+ */
+static bool unsignedValueOk()
+{
+    CayenneLPP<51> lpp(51);
+    lpp.addUnixTime(1, 3000000000UL);
+    const CayenneLPPView view(lpp.getBuffer(), lpp.getSize());
+    if (view.validate() != ERROR_TYPES::LPP_ERROR_OK)
+    {
+        return false;
+    }
+    const CayenneField field = *view.begin();
+    return field.unsignedValue() == 3000000000UL && field.value() == 3000000000.0f;
+}
+
+int main()
+{
+    const bool framePool = framePoolOk();
+    const bool priorityPacker = priorityPackerOk();
+    const bool eventRing = eventRingOk();
+    const bool timeSeries = timeSeriesOk();
+    const bool bulkDecoder = bulkDecoderReuseOk();
+    const bool unsignedValue = unsignedValueOk();
+    printf("FramePool:       %s\n", framePool ? "ok" : "MISMATCH");
+    printf("PriorityPacker:  %s\n", priorityPacker ? "ok" : "MISMATCH");
+    printf("EventRing:       %s\n", eventRing ? "ok" : "MISMATCH");
+    printf("TimeSeries:      %s\n", timeSeries ? "ok" : "MISMATCH");
+    printf("LppBulkDecoder:  %s\n", bulkDecoder ? "ok" : "MISMATCH");
+    printf("CayenneLPPView:  %s\n", unsignedValue ? "ok" : "MISMATCH");
+    return framePool && priorityPacker && eventRing && timeSeries && bulkDecoder && unsignedValue ? 0 : 2;
+}
@@ -116,7 +116,6 @@ const char err[] PROGMEM = "err"; /**< @brief String constant stored in PROGMEM
 */
 const char *const compareerr_table[] PROGMEM = {ok, busy, fram_counter_err_rejoin_needed, invalid_class, invalid_data_len, invalid_param, keys_not_init, mac_paused, multicast_keys_not_set, no_free_ch, not_joined, silent, err};
 
-#if defined(YES_DEBUG)
 #define CMP_ERR_OK 0 /**< @brief Error code representing OK. */
 #define CMP_ERR_BUSY 1 /**< @brief Error code representing busy. */
 #define CMP_ERR_FRMCNT 2 /**< @brief Error code representing frame counter error, rejoin needed. */
@@ -132,7 +131,21 @@ const char *const compareerr_table[] PROGMEM = {ok, busy, fram_counter_err_rejoi
 #define CMP_ERR_ERR 12 /**< Error code representing error. */
 
 #define CMP_ERR_LAST CMP_ERR_ERR /**< @brief Represents the last error code. */
-#endif
+
+/**
+   @brief Maximum application payload in bytes per EU868 data rate, DR0 (SF12) to DR7.
+
+   Values from the LoRaWAN Regional Parameters for EU863-870. Stored in PROGMEM like the string tables.
+*/
+const uint8_t max_payload_eu868[] PROGMEM = {51, 51, 51, 115, 222, 222, 222, 222};
+
+/**
+   @brief Time on air in milliseconds of a maximum size uplink per EU868 data rate, DR0 (SF12) to DR7.
+
+   Computed with the LoRa airtime formula for the payloads of max_payload_eu868 plus 13 bytes of LoRaWAN overhead.
+   Used as an upper bound for the time the modem needs for an uplink, see getTxTimeout().
+*/
+const uint16_t max_airtime_eu868[] PROGMEM = {2793, 1561, 698, 677, 656, 369, 184, 50};
 
 #define SENDING "Sending: " /**< @brief Message prefix for sending. */
 #define SEND_MSG "\r\n"    /**< @brief Message suffix for sending. */
@@ -190,9 +203,11 @@ const char PROGMEM check_configuration[] = "Check your coverage, keys and backen
 const char PROGMEM no_response[] = "No response from RN module.";
 /** @brief Error message for invalid module. */
 const char PROGMEM invalid_module[] = "Invalid module (must be RN2xx3[xx]).";
+/** @brief Error message for a payload that does not fit the current data rate. */
+const char PROGMEM payload_too_large[] = "Payload too large for data rate: ";
 
 /** @brief Array of error messages stored in PROGMEM. */
-const char *const PROGMEM error_msg[] = {invalid_sf, invalid_fp, unexpected_response, send_command_failed, join_failed, join_not_accepted, personalize_not_accepted, response_is_not_ok, error_key_length, check_configuration, no_response, invalid_module};
+const char *const PROGMEM error_msg[] = {invalid_sf, invalid_fp, unexpected_response, send_command_failed, join_failed, join_not_accepted, personalize_not_accepted, response_is_not_ok, error_key_length, check_configuration, no_response, invalid_module, payload_too_large};
 #endif
 
 /** @brief Error code for "Invalid SF". */
@@ -219,6 +234,8 @@ const char *const PROGMEM error_msg[] = {invalid_sf, invalid_fp, unexpected_resp
 #define ERR_NO_RESPONSE 10
 /** @brief Error code for "Invalid module (must be RN2xx3[xx])". */
 #define ERR_INVALID_MODULE 11
+/** @brief Error code for "Payload too large for data rate". */
+#define ERR_PAYLOAD_TOO_LARGE 12
 
 #if defined(YES_DEBUG)
 /** @brief String indicating personalize accepted along with status. */
@@ -506,6 +523,79 @@ uint8_t receivedPort(const char *s)
   return port;
 }
 
+/**
+   @brief Print adapter that writes every byte as two uppercase hex characters.
+
+   Payloads are streamed through this adapter to the modem, so no hex copy of the payload is needed in RAM.
+   Bytes are converted in small blocks to keep the number of stream calls low.
+*/
+class HexPrint : public Print
+{
+public:
+  /**
+     @param out The stream the hex characters are written to.
+     @param echo Optional second stream that receives the same characters, e.g. the debug stream.
+  */
+  HexPrint(Stream *out, Stream *echo) : out(out), echo(echo) {}
+
+  size_t write(uint8_t value)
+  {
+    return write(&value, 1);
+  }
+
+  size_t write(const uint8_t *data, size_t size)
+  {
+    static const char digitsHex[] = "0123456789ABCDEF";
+    uint8_t hex[32];
+    size_t done = 0;
+    while (done < size)
+    {
+      size_t block = (size - done > sizeof(hex) / 2) ? sizeof(hex) / 2 : size - done;
+      for (size_t i = 0; i < block; i++)
+      {
+        hex[2 * i] = digitsHex[data[done + i] >> 4];
+        hex[2 * i + 1] = digitsHex[data[done + i] & 0x0F];
+      }
+      out->write(hex, 2 * block);
+      if (echo)
+      {
+        echo->write(hex, 2 * block);
+      }
+      done += block;
+    }
+    return size;
+  }
+
+private:
+  Stream *out;
+  Stream *echo;
+};
+
+/**
+   @brief Print adapter that only counts the bytes written to it.
+
+   Used to measure a Printable payload before it is streamed to the modem.
+*/
+class CountingPrint : public Print
+{
+public:
+  CountingPrint() : count(0) {}
+
+  size_t write(uint8_t)
+  {
+    count++;
+    return 1;
+  }
+
+  size_t write(const uint8_t *, size_t size)
+  {
+    count += size;
+    return size;
+  }
+
+  size_t count; ///< Number of bytes written so far.
+};
+
 /**
    @brief Constructor for TheThingsNetwork class.
 
@@ -584,10 +674,111 @@ size_t TheThingsNetwork::getVersion(char *buffer, size_t size)
 uint16_t TheThingsNetwork::getVDD()
 {
   if (readResponse(SYS_TABLE, SYS_TABLE, SYS_GET_VDD, buffer, sizeof(buffer)) > 0) {
-    return atoi(buffer);
+    lastVDD = atoi(buffer);
+    return lastVDD;
   }
   return 0;
 }
+/**
+   @brief Starts a VDD query without waiting for the answer.
+
+   A sleeping module first gets the sync sequence of fastWake(), so waking the module and the query take a
+   single round trip that overlaps with other work of the MCU, e.g. a sensor conversion. process() collects the
+   answer; the lines before it (the "ok" of an ended sleep, the answer to the sync sequence) are skipped. When no
+   answer comes within 3 * TTN_FAST_WAKE_TIMEOUT ms, process() falls back to the full auto-baud and a blocking
+   query.
+*/
+void TheThingsNetwork::startGetVDD()
+{
+  if (txPending || vddPending)
+  {
+    finishPending();
+  }
+  vddWaking = modemAsleep;
+  if (modemAsleep)
+  {
+    vddWakeStart = micros();
+    modemAsleep = false; // sendCommand() must not wake the module again
+    clearReadBuffer();
+    modemStream->write((byte)0x00);
+    modemStream->write(0x55);
+    modemStream->write(SEND_MSG);
+  }
+  sendCommand(SYS_TABLE, 0, true, false);
+  sendCommand(SYS_TABLE, SYS_GET, true, false);
+  sendCommand(SYS_TABLE, SYS_GET_VDD, false, false);
+  modemStream->write(SEND_MSG);
+  lineLength = 0;
+  vddPending = true;
+  vddStart = clock();
+}
+/**
+   @brief Checks whether the VDD query from startGetVDD() still waits for its answer.
+
+   @return True until process() collected the answer.
+*/
+bool TheThingsNetwork::isVDDPending()
+{
+  return vddPending;
+}
+/**
+   @brief Returns the last VDD reading of getVDD() or startGetVDD().
+
+   @return The supply voltage in millivolts, 0 before the first reading.
+*/
+uint16_t TheThingsNetwork::getLastVDD()
+{
+  return lastVDD;
+}
+/**
+   @brief Queries the current data rate from the modem and caches it for getMaxPayload().
+
+   @return The data rate (0..7), or -1 if the modem did not answer.
+*/
+int8_t TheThingsNetwork::getDR()
+{
+  if (readResponse(MAC_TABLE, MAC_GET_SET_TABLE, MAC_DR, buffer, sizeof(buffer)) > 0) {
+    dr = atoi(buffer);
+    drAge = 0;
+    return dr;
+  }
+  return -1;
+}
+
+/**
+   @brief Returns the maximum application payload for the current data rate.
+
+   The data rate is cached by setSF() and getDR(). With ADR enabled the network changes the data rate with a
+   LinkADRReq in a downlink, and the modem lowers it itself when the network stays silent (ADR backoff). The cache
+   is therefore dropped after a downlink and after TTN_DR_REFRESH_UPLINKS uplinks, see ageDR(), and the data rate
+   is queried again on the next call. A LinkADRReq in a downlink without application data ("mac_tx_ok") is
+   picked up with that delay.
+
+   @return The maximum payload in bytes from the EU868 table. If the data rate is unknown the DR0 value is returned.
+*/
+uint8_t TheThingsNetwork::getMaxPayload()
+{
+  if (dr < 0)
+  {
+    getDR();
+  }
+  return pgm_read_byte(&max_payload_eu868[(dr >= 0 && dr <= 7) ? dr : 0]);
+}
+
+/**
+   @brief Counts an uplink for the data rate cache of getMaxPayload().
+
+   With ADR enabled the cache is dropped every TTN_DR_REFRESH_UPLINKS uplinks, so a busy device does not pay a
+   "mac get dr" round trip per uplink.
+*/
+void TheThingsNetwork::ageDR()
+{
+  if (adr && ++drAge >= TTN_DR_REFRESH_UPLINKS)
+  {
+    dr = -1;
+  }
+}
+
 /** @brief These functions are not used and not needed by default.
   uint8_t TheThingsNetwork::getBW()
   {
@@ -682,14 +873,6 @@ enum ttn_modem_status_t TheThingsNetwork::getStatus()
    return -128;
   }
 
-  int8_t TheThingsNetwork::getDR()
-  {
-   if (readResponse(MAC_TABLE, MAC_GET_SET_TABLE, MAC_DR, buffer, sizeof(buffer))){
-     return atoi(buffer);
-   }
-   return -1;
-  }
-
   int8_t TheThingsNetwork::getPowerIndex()
   {
    if (readResponse(MAC_TABLE, MAC_GET_SET_TABLE, MAC_PWRIDX, buffer, sizeof(buffer)) > 0) {
@@ -794,10 +977,15 @@ void TheThingsNetwork::debugPrintMessage(uint8_t type, uint8_t index, const char
 */
 void TheThingsNetwork::clearReadBuffer()
 {
+  if (txPending || vddPending)
+  {
+    finishPending(); // the result of the uplink or the VDD query is still in the stream
+  }
   while (modemStream->available())
   {
     modemStream->read();
   }
+  lineLength = 0; // the blocking commands reuse buffer
 }
 /**
    @brief Reads a line from the modemStream into the provided buffer.
@@ -891,6 +1079,43 @@ void TheThingsNetwork::autoBaud()
   modemStream->setTimeout(TTN_DEFAULT_TIMEOUT);
   baudDetermined = true;
 }
+/**
+   @brief Wakes the modem with a single sync sequence and the shortest probe.
+
+   Sends break and 0x55 once, followed by "sys get vdd", whose answer is a few digits, and waits at
+   most TTN_FAST_WAKE_TIMEOUT ms per line. The "ok" of an ended sleep and the answer to the sync
+   sequence itself are skipped.
+
+   @return True if the modem answered the probe, false if the full autoBaud() is needed.
+*/
+bool TheThingsNetwork::fastWake()
+{
+  clearReadBuffer();
+  modemStream->setTimeout(TTN_FAST_WAKE_TIMEOUT);
+  modemStream->write((byte)0x00);
+  modemStream->write(0x55);
+  modemStream->write(SEND_MSG);
+  sendCommand(SYS_TABLE, 0, true, false);
+  sendCommand(SYS_TABLE, SYS_GET, true, false);
+  sendCommand(SYS_TABLE, SYS_GET_VDD, false, false);
+  modemStream->write(SEND_MSG);
+
+  bool ready = false;
+  for (uint8_t lines = 0; lines < 3 && !ready; lines++)
+  {
+    if (modemStream->readBytesUntil('\n', buffer, sizeof(buffer)) == 0)
+    {
+      break;
+    }
+    ready = buffer[0] >= '1' && buffer[0] <= '9'; // a VDD reading in mV
+  }
+  modemStream->setTimeout(TTN_DEFAULT_TIMEOUT);
+  if (ready)
+  {
+    baudDetermined = true;
+  }
+  return ready;
+}
 /**
    @brief Resets the LoRaWAN modem.
 
@@ -973,6 +1198,9 @@ void TheThingsNetwork::saveState()
    - payload: Pointer to the received data payload.
    - size: Size of the received data payload.
    - port: Port number on which the message was received.
+
+   The callback runs after the uplink that carried the downlink has ended, also for an uplink from
+   startSendBytes() whose result is handled by process(), so it may send modem commands and new uplinks.
 */
 void TheThingsNetwork::onMessage(void (*cb)(const uint8_t *payload, size_t size, port_t port))
 {
@@ -1210,6 +1438,10 @@ ttn_response_t TheThingsNetwork::parseBytes() {
 
   if (pgmstrcmp(buffer, CMP_MAC_RX) == 0)
   {
+    if (adr)
+    {
+      dr = -1; // the downlink may carry a LinkADRReq
+    }
     port_t downlinkPort = receivedPort(buffer + 7);
     char *data = buffer + 7 + digits(downlinkPort) + 1;
     size_t downlinkLength = strlen(data) / 2;
@@ -1242,6 +1474,11 @@ ttn_response_t TheThingsNetwork::parseBytes() {
 
    This function sends a byte array over LoRaWAN with the specified transmission parameters,
    including payload, port, confirmation mode, and spreading factor (SF).
+   If fragmentation is enabled with setFragmentation() and the payload is larger than the maximum payload of the
+   data rate, it is sent as a series of fragments, see startFragments(). The fragments are sent back to back;
+   when the modem refuses one because of the duty cycle the error is returned right away and the remaining
+   fragments stay queued for sendNextFragment() (check isFragmenting()). Otherwise the payload is rejected
+   without talking to the modem.
 
    @param payload Pointer to the byte array containing the payload data.
    @param length The length of the payload data.
@@ -1252,6 +1489,8 @@ ttn_response_t TheThingsNetwork::parseBytes() {
        - TTN_SUCCESSFUL_TRANSMISSION: Transmission successful.
        - TTN_ERROR_SEND_COMMAND_FAILED: Failed to send the command.
        - TTN_UNSUCCESSFUL_RECEIVE: Unsuccessful reception or confirmed transmission with RX timeout.
+       - TTN_ERROR_PAYLOAD_TOO_LARGE: The payload is larger than getMaxPayload() and fragmentation is disabled,
+         or it needs more than TTN_FRAGMENT_MAX_COUNT fragments.
 */
 ttn_response_t TheThingsNetwork::sendBytes(const uint8_t *payload, size_t length, port_t port, bool confirm, uint8_t sf)
 {
@@ -1260,12 +1499,106 @@ ttn_response_t TheThingsNetwork::sendBytes(const uint8_t *payload, size_t length
     setSF(sf);
   }
 
+  uint8_t maxPayload = getMaxPayload();
+  if (length > maxPayload)
+  {
+    if (fragmentPort != 0)
+    {
+      ttn_response_t response = startFragments(payload, length, port, confirm);
+      while (response >= 0 && response != TTN_UNSUCCESSFUL_RECEIVE && isFragmenting())
+      {
+        response = sendNextFragment();
+      }
+      return response;
+    }
+    // Rejected locally, the modem would answer invalid_data_len after the whole hex dump.
+#if defined(YES_DEBUG)
+    char size[6];
+    sprintf(size, "%u", (unsigned)length);
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE, size);
+#endif
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+  return sendFrame(payload, length, port, confirm);
+}
+
+/**
+   @brief Sends one uplink and handles the modem response.
+
+   This is the body of sendBytes() without the spreading factor and fragmentation handling.
+
+   @param payload Pointer to the byte array containing the payload data.
+   @param length The length of the payload data.
+   @param port The port number used for sending the payload.
+   @param confirm Set to true to request confirmation from the network, false otherwise.
+   @return The status of the transmission operation, see sendBytes().
+*/
+ttn_response_t TheThingsNetwork::sendFrame(const uint8_t *payload, size_t length, port_t port, bool confirm)
+{
   uint8_t mode = confirm ? MAC_TX_TYPE_CNF : MAC_TX_TYPE_UCNF;
   if (!sendPayload(mode, port, (uint8_t *)payload, length))
   {
     debugPrintMessage(ERR_MESSAGE, ERR_SEND_COMMAND_FAILED);
     return TTN_ERROR_SEND_COMMAND_FAILED;
   }
+  txStart = clock();
+  return readTxResponse(confirm);
+}
+
+/**
+   @brief Sends a payload that is streamed to the modem while it is encoded.
+
+   The payload writes its bytes to the Print it is given in printTo(), for example with a CayenneLPPStream. It is
+   printed twice: once to measure it and once through a hex adapter straight into the modem stream. The payload
+   therefore never needs a binary or hex buffer in RAM, but printTo() must produce the same bytes on every call
+   (read the sensors before calling this function, not inside printTo()).
+
+   Streamed payloads are not fragmented; a payload larger than getMaxPayload() is rejected locally.
+
+   @param payload The payload to send.
+   @param port The port number used for sending the payload.
+   @param confirm Set to true to request confirmation from the network, false otherwise.
+   @return The status of the transmission operation, see sendBytes(const uint8_t *, size_t, port_t, bool, uint8_t).
+*/
+ttn_response_t TheThingsNetwork::sendBytes(const Printable &payload, port_t port, bool confirm)
+{
+  CountingPrint counter;
+  payload.printTo(counter);
+  if (counter.count > getMaxPayload())
+  {
+#if defined(YES_DEBUG)
+    char size[6];
+    sprintf(size, "%u", (unsigned)counter.count);
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE, size);
+#endif
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+
+  beginPayload(confirm ? MAC_TX_TYPE_CNF : MAC_TX_TYPE_UCNF, port);
+#if defined(YES_DEBUG)
+  HexPrint hex(modemStream, debugStream);
+#else
+  HexPrint hex(modemStream, NULL);
+#endif
+  payload.printTo(hex);
+  if (!endPayload())
+  {
+    debugPrintMessage(ERR_MESSAGE, ERR_SEND_COMMAND_FAILED);
+    return TTN_ERROR_SEND_COMMAND_FAILED;
+  }
+  txStart = clock();
+  return readTxResponse(confirm);
+}
+
+/**
+   @brief Reads the result of an uplink after the modem accepted the mac tx command.
+
+   @param confirm Set to true if the uplink was sent confirmed.
+   @return The status of the transmission operation, see sendBytes().
+*/
+ttn_response_t TheThingsNetwork::readTxResponse(bool confirm)
+{
+  ageDR();
 
   // read modem response
   if (!readLine(buffer, sizeof(buffer)) && confirm) // Read response
@@ -1285,6 +1618,453 @@ ttn_response_t TheThingsNetwork::sendBytes(const uint8_t *payload, size_t length
   return parseBytes();
 }
 
+/**
+   @brief Sends an urgent uplink, e.g. an alarm, as fast as possible.
+
+   Meant to be called right after the event woke the MCU. A sleeping module is woken by the fast path (see
+   fastWake()), an uplink that is already on air is finished first (the modem cannot abort it), and the payload is
+   sent before any other traffic of the application. A confirmed uplink is retransmitted by the modem until it is
+   acknowledged, at most retries times.
+
+   The RN2483 keeps the duty-cycle budget of every channel and picks a free channel itself. When all budgets are
+   used up ("no_free_ch") or the modem is busy, the uplink is not sent and TTN_ERROR_DEFERRED is returned; waiting
+   awake does not help, the 1% duty cycle of the EU868 default channels holds the next uplink back for 99 times the
+   airtime of the previous one, up to 4.6 minutes after a 51-byte uplink at SF12. Keep the payload, sleep, and call
+   sendUrgent() again later; the worst-case latency is that off-time plus the retry interval of the application.
+   Holding back regular uplinks while an urgent one is deferred keeps them from taking the budget first.
+
+   The payload is not fragmented, a payload larger than getMaxPayload() is rejected locally. Use getTxStartTime()
+   to measure the latency from the event to the start of the transmission.
+
+   @param payload Pointer to the byte array containing the payload data.
+   @param length The length of the payload data.
+   @param port The port number used for sending the payload.
+   @param confirm Set to true to request confirmation from the network, false otherwise.
+   @param retries Maximum number of retransmissions of a confirmed uplink.
+   @return The status of the transmission operation, see sendBytes(), or TTN_ERROR_DEFERRED.
+*/
+ttn_response_t TheThingsNetwork::sendUrgent(const uint8_t *payload, size_t length, port_t port, bool confirm, uint8_t retries)
+{
+  if (length > getMaxPayload())
+  {
+#if defined(YES_DEBUG)
+    char size[6];
+    sprintf(size, "%u", (unsigned)length);
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE, size);
+#endif
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+  char retx[4];
+  if (confirm)
+  {
+    sprintf(retx, "%u", retries);
+    sendMacSet(MAC_RETX, retx);
+  }
+
+  buffer[0] = '\0'; // a missing response never compares equal to an error string
+  ttn_response_t response = sendFrame(payload, length, port, confirm);
+  if (response == TTN_ERROR_SEND_COMMAND_FAILED &&
+      (pgmstrcmp(buffer, CMP_ERR_NFRCHN, CMP_ERR_TABLE) == 0 || pgmstrcmp(buffer, CMP_ERR_BUSY, CMP_ERR_TABLE) == 0))
+  {
+    response = TTN_ERROR_DEFERRED;
+  }
+
+  if (confirm)
+  {
+    sendMacSet(MAC_RETX, TTN_RETX);
+  }
+  return response;
+}
+
+/**
+   @brief Returns the time the modem accepted the last uplink, which is when its transmission started.
+
+   @return Time of the clock set by setClock() (millis() by default).
+*/
+unsigned long TheThingsNetwork::getTxStartTime()
+{
+  return txStart;
+}
+
+/**
+   @brief Starts an uplink without waiting for its result.
+
+   Returns as soon as the modem accepted the mac tx command. The result ("mac_tx_ok", a downlink or "mac_err")
+   arrives seconds later, after the receive windows, and is returned by process(). Until then the MCU is free,
+   e.g. to sleep until the modem output wakes it. Any other modem command first waits for the result.
+
+   @param payload Pointer to the byte array containing the payload data.
+   @param length The length of the payload data.
+   @param port The port number used for sending the payload.
+   @param confirm Set to true to request confirmation from the network, false otherwise.
+   @return TTN_PENDING if the modem accepted the uplink, TTN_ERROR_PAYLOAD_TOO_LARGE for a payload larger than
+           getMaxPayload() (there is no fragmentation here) or TTN_ERROR_SEND_COMMAND_FAILED.
+*/
+ttn_response_t TheThingsNetwork::startSendBytes(const uint8_t *payload, size_t length, port_t port, bool confirm)
+{
+  if (length > getMaxPayload())
+  {
+#if defined(YES_DEBUG)
+    char size[6];
+    sprintf(size, "%u", (unsigned)length);
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE, size);
+#endif
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+  if (!sendPayload(confirm ? MAC_TX_TYPE_CNF : MAC_TX_TYPE_UCNF, port, (uint8_t *)payload, length))
+  {
+    debugPrintMessage(ERR_MESSAGE, ERR_SEND_COMMAND_FAILED);
+    return TTN_ERROR_SEND_COMMAND_FAILED;
+  }
+  txTimeout = getTxTimeout(confirm);
+  ageDR();
+  lineLength = 0;
+  txPending = true;
+  txStart = clock();
+  return TTN_PENDING;
+}
+
+/**
+   @brief Returns the time after which a pending uplink without result means the modem is stuck.
+
+   The modem prints nothing between accepting the uplink and its result, so the limit covers the whole uplink:
+   the time on air at the current data rate and both receive windows, and for a confirmed uplink every
+   retransmission (TTN_RETX) with the 1% duty cycle off-time the modem waits before it, plus TTN_DEFAULT_TIMEOUT
+   as margin. A confirmed uplink at DR0 may legitimately take half an hour.
+
+   @param confirm Set to true if the uplink is sent confirmed.
+   @return The timeout in milliseconds.
+*/
+unsigned long TheThingsNetwork::getTxTimeout(bool confirm)
+{
+  const unsigned long airtime = pgm_read_word(&max_airtime_eu868[(dr >= 0 && dr <= 7) ? dr : 0]);
+  const unsigned long attempt = airtime + TTN_RX_WINDOWS_TIME;
+  unsigned long timeout = TTN_DEFAULT_TIMEOUT + attempt;
+  if (confirm)
+  {
+    timeout += atoi(TTN_RETX) * (100 * airtime + attempt); // off-time of 99 times the airtime before every retry
+  }
+  return timeout;
+}
+
+/**
+   @brief Checks whether an uplink from startSendBytes() still waits for its result.
+
+   @return True until process() returned the result or the modem did not answer within the uplink timeout, see
+           getTxTimeout().
+*/
+bool TheThingsNetwork::isSending()
+{
+  return txPending;
+}
+
+/**
+   @brief Incremental response parser: consumes the modem output that is available without waiting.
+
+   Bytes are collected in the communication buffer until a line is complete, so a line may arrive over several
+   calls, e.g. one call per wake-up by the modem output. Complete lines are handled as follows:
+   - the answer to a pending VDD query from startGetVDD() ends it, other lines before it are skipped;
+   - the result of a pending uplink ends it: "mac_tx_ok", "mac_err", or "mac_rx", which is passed to the
+     onMessage() callback;
+   - "ok" outside an uplink is the end of a modem sleep and marks the modem awake;
+   - any other line is reported as unexpected, e.g. the tail of a line whose first bytes were lost while the
+     MCU woke from power down.
+
+   @return The result of the first handled line, TTN_PENDING if no line changed anything, or
+           TTN_UNSUCCESSFUL_RECEIVE when a pending uplink timed out (see getTxTimeout()). Lines after the first result stay in the
+           stream for the next call. A VDD answer does not end the call, check isVDDPending().
+*/
+ttn_response_t TheThingsNetwork::process()
+{
+  while (modemStream->available())
+  {
+    char c = modemStream->read();
+    if (c != '\n')
+    {
+      if (lineLength < sizeof(buffer) - 1)
+      {
+        buffer[lineLength++] = c; // longer lines are cut and rejected when they are handled
+      }
+      continue;
+    }
+    if (lineLength > 0 && buffer[lineLength - 1] == '\r')
+    {
+      lineLength--;
+    }
+    buffer[lineLength] = '\0';
+    lineLength = 0;
+    ttn_response_t response = handleLine();
+    if (response != TTN_PENDING)
+    {
+      return response;
+    }
+  }
+  if (vddPending && clock() - vddStart > 3 * TTN_FAST_WAKE_TIMEOUT)
+  {
+    vddPending = false;
+    autoBaud(); // the sync sequence did not wake the module
+    getVDD();
+    if (vddWaking)
+    {
+      wakeLatency = micros() - vddWakeStart;
+    }
+  }
+  if (txPending && clock() - txStart > txTimeout)
+  {
+    txPending = false;
+    needsHardReset = true;
+    debugPrintMessage(ERR_MESSAGE, ERR_NO_RESPONSE);
+    return TTN_UNSUCCESSFUL_RECEIVE;
+  }
+  return TTN_PENDING;
+}
+
+/**
+   @brief Waits until the pending uplink from startSendBytes() and the pending VDD query have their result or
+   timed out.
+
+   A downlink in the result still goes to the onMessage() callback.
+*/
+void TheThingsNetwork::finishPending()
+{
+  while (txPending || vddPending)
+  {
+    process();
+  }
+}
+
+/**
+   @brief Handles one complete line for process().
+
+   @return The result of the line, see process().
+*/
+ttn_response_t TheThingsNetwork::handleLine()
+{
+  modemAsleep = false; // a modem that writes is awake
+  if (buffer[0] == '\0')
+  {
+    return TTN_PENDING;
+  }
+  if (vddPending)
+  {
+    if (buffer[0] >= '1' && buffer[0] <= '9') // a VDD reading in mV
+    {
+      vddPending = false;
+      lastVDD = atoi(buffer);
+      if (vddWaking)
+      {
+        wakeLatency = micros() - vddWakeStart;
+        baudDetermined = true;
+      }
+    }
+    return TTN_PENDING;
+  }
+  if (!txPending)
+  {
+    if (pgmstrcmp(buffer, CMP_OK) == 0)
+    {
+      return TTN_PENDING;
+    }
+    debugPrintMessage(ERR_MESSAGE, ERR_UNEXPECTED_RESPONSE, buffer);
+    return TTN_ERROR_UNEXPECTED_RESPONSE;
+  }
+  if (pgmstrcmp(buffer, CMP_MAC_TX_OK) == 0)
+  {
+    txPending = false;
+    debugPrintMessage(SUCCESS_MESSAGE, SCS_SUCCESSFUL_TRANSMISSION);
+    return TTN_SUCCESSFUL_TRANSMISSION;
+  }
+  if (pgmstrcmp(buffer, CMP_MAC_ERR) == 0)
+  {
+    txPending = false;
+    return TTN_UNSUCCESSFUL_RECEIVE;
+  }
+  // A downlink ends the uplink before the onMessage() callback runs, so the callback may send modem commands
+  // (or a new uplink) without waiting in finishPending() for the result it is handling.
+  txPending = false;
+  ttn_response_t response = parseBytes();
+  if (response != TTN_SUCCESSFUL_RECEIVE)
+  {
+    txPending = true; // not the result of the uplink, keep waiting
+  }
+  return response;
+}
+
+/**
+   @brief Starts a payload that is larger than the data rate allows as a series of fragments.
+
+   The original port and the payload are sent as one stream ([port][payload...]) cut into pieces that fit the
+   data rate. Every fragment is sent on the fragment port with a two byte header:
+   byte 0 is the message ID and byte 1 holds the fragment index (high nibble) and the index of the last fragment
+   (low nibble). The reassembler in extras/FragmentReassembler.hpp rebuilds the original frame.
+
+   Nothing is sent here: every fragment is one uplink, sent by sendNextFragment() or startNextFragment() when
+   the application schedules it, so the MCU can sleep between fragments and the modem can regain its duty-cycle
+   budget. The payload must stay valid until isFragmenting() returns false.
+
+   @param payload Pointer to the byte array containing the payload data.
+   @param length The length of the payload data.
+   @param port The port number of the reassembled message.
+   @param confirm Set to true to send every fragment confirmed.
+   @return TTN_PENDING if the message was queued, TTN_ERROR_SEND_COMMAND_FAILED if fragmentation is disabled or
+           TTN_ERROR_PAYLOAD_TOO_LARGE if it needs more than TTN_FRAGMENT_MAX_COUNT fragments at the current data
+           rate. A message that was still being sent is dropped.
+*/
+ttn_response_t TheThingsNetwork::startFragments(const uint8_t *payload, size_t length, port_t port, bool confirm)
+{
+  fragmentPayload = NULL;
+  if (fragmentPort == 0)
+  {
+    debugPrintMessage(ERR_MESSAGE, ERR_SEND_COMMAND_FAILED);
+    return TTN_ERROR_SEND_COMMAND_FAILED;
+  }
+  size_t chunk = getMaxPayload() - TTN_FRAGMENT_HEADER_SIZE;
+  if ((length + 1 + chunk - 1) / chunk > TTN_FRAGMENT_MAX_COUNT) // the port travels as the first byte
+  {
+#if defined(YES_DEBUG)
+    char size[6];
+    sprintf(size, "%u", (unsigned)length);
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE, size);
+#endif
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+  fragmentId++;
+  fragmentPayload = payload;
+  fragmentLength = length;
+  fragmentOffset = 0;
+  fragmentIndex = 0;
+  fragmentMessagePort = port;
+  fragmentConfirm = confirm;
+  return TTN_PENDING;
+}
+
+/**
+   @brief Sends the next fragment of the message from startFragments() and waits for its result, like sendBytes().
+
+   @return The status of the fragment, see sendBytes(). TTN_ERROR_SEND_COMMAND_FAILED while isFragmenting() is
+           still true means the modem refused the fragment because of the duty cycle or because it was busy; call
+           again later. See sendFragment() for the other errors.
+*/
+ttn_response_t TheThingsNetwork::sendNextFragment()
+{
+  return sendFragment(true);
+}
+
+/**
+   @brief Starts the next fragment of the message from startFragments() without waiting for its result, like
+   startSendBytes(). The result is returned by process().
+
+   @return TTN_PENDING if the modem accepted the fragment, otherwise see sendNextFragment().
+*/
+ttn_response_t TheThingsNetwork::startNextFragment()
+{
+  return sendFragment(false);
+}
+
+/**
+   @brief Checks whether the message from startFragments() has fragments left to send.
+
+   @return True until the last fragment was accepted by the modem or the message was dropped.
+*/
+bool TheThingsNetwork::isFragmenting()
+{
+  return fragmentPayload != NULL;
+}
+
+/**
+   @brief Builds the next fragment in the upper half of the response buffer.
+
+   The buffer is only overwritten by the modem response after the hex dump has been sent. The maximum payload is
+   looked up for every fragment because ADR may change the data rate between two uplinks; the last index in the
+   header is the estimate at the current data rate, the reassembler takes the one of the final fragment.
+
+   @return The size of the fragment including its header, 0 if the rest does not fit in TTN_FRAGMENT_MAX_COUNT
+           fragments at the current data rate.
+*/
+size_t TheThingsNetwork::buildFragment()
+{
+  size_t chunk = getMaxPayload() - TTN_FRAGMENT_HEADER_SIZE;
+  size_t rest = fragmentLength + 1 - fragmentOffset;
+  size_t last = fragmentIndex + (rest + chunk - 1) / chunk - 1;
+  if (last >= TTN_FRAGMENT_MAX_COUNT)
+  {
+    return 0;
+  }
+  size_t size = (rest < chunk) ? rest : chunk;
+  uint8_t *fragment = (uint8_t *)buffer + sizeof(buffer) / 2;
+  fragment[0] = fragmentId;
+  fragment[1] = (fragmentIndex << 4) | last;
+  for (size_t i = 0; i < size; i++)
+  {
+    size_t offset = fragmentOffset + i;
+    fragment[TTN_FRAGMENT_HEADER_SIZE + i] = (offset == 0) ? fragmentMessagePort : fragmentPayload[offset - 1];
+  }
+  return TTN_FRAGMENT_HEADER_SIZE + size;
+}
+
+/**
+   @brief Sends the next fragment for sendNextFragment() and startNextFragment().
+
+   A fragment the modem refused with "no_free_ch" or "busy" stays queued; any other refusal drops the message,
+   the backend drops the incomplete message when the next message ID arrives.
+
+   @param wait Set to true to wait for the result of the uplink.
+   @return The status of the fragment, TTN_ERROR_UNEXPECTED_RESPONSE if no message is being sent or
+           TTN_ERROR_PAYLOAD_TOO_LARGE if the data rate dropped so far that the rest no longer fits.
+*/
+ttn_response_t TheThingsNetwork::sendFragment(bool wait)
+{
+  if (txPending || vddPending)
+  {
+    finishPending();
+  }
+  if (!fragmentPayload)
+  {
+    return TTN_ERROR_UNEXPECTED_RESPONSE;
+  }
+  size_t size = buildFragment();
+  if (size == 0)
+  {
+    fragmentPayload = NULL;
+    debugPrintMessage(ERR_MESSAGE, ERR_PAYLOAD_TOO_LARGE);
+    return TTN_ERROR_PAYLOAD_TOO_LARGE;
+  }
+  uint8_t *fragment = (uint8_t *)buffer + sizeof(buffer) / 2;
+  buffer[0] = '\0'; // a missing response never compares equal to an error string
+  ttn_response_t response = wait ? sendFrame(fragment, size, fragmentPort, fragmentConfirm)
+                                 : startSendBytes(fragment, size, fragmentPort, fragmentConfirm);
+  if (response == TTN_ERROR_SEND_COMMAND_FAILED)
+  {
+    if (pgmstrcmp(buffer, CMP_ERR_NFRCHN, CMP_ERR_TABLE) != 0 && pgmstrcmp(buffer, CMP_ERR_BUSY, CMP_ERR_TABLE) != 0)
+    {
+      fragmentPayload = NULL;
+    }
+    return response;
+  }
+  fragmentOffset += size - TTN_FRAGMENT_HEADER_SIZE;
+  fragmentIndex++;
+  if (fragmentOffset >= fragmentLength + 1)
+  {
+    fragmentPayload = NULL;
+  }
+  return response;
+}
+
+/**
+   @brief Enables or disables fragmentation of payloads that are too large for the current data rate.
+
+   When enabled, sendBytes() splits such payloads into fragments instead of letting the modem reject them with
+   "invalid_data_len". Fragments are sent on a separate port so the backend can tell them apart from normal uplinks.
+   Use startFragments() to schedule the fragments one by one instead.
+
+   @param enabled Set to true to enable fragmentation.
+   @param port The port used for the fragments (1..223).
+*/
+void TheThingsNetwork::setFragmentation(bool enabled, port_t port)
+{
+  fragmentPort = enabled ? port : 0;
+}
+
 /**
    @brief Polls the LoRaWAN network for pending messages or transmissions.
 
@@ -1764,7 +2544,13 @@ bool TheThingsNetwork::setSF(uint8_t sf)
   char s[2];
   s[0] = '0' + dr;
   s[1] = '\0';
-  return sendMacSet(MAC_DR, s);
+  if (!sendMacSet(MAC_DR, s))
+  {
+    return false;
+  }
+  this->dr = dr; // cached for getMaxPayload()
+  drAge = 0;
+  return true;
 }
 
 /** @brief This function is not included in the LoRaWAN class's standard criteria because it is specifically tailored to set the RX1 delay, 
@@ -1802,6 +2588,14 @@ bool TheThingsNetwork::setSF(uint8_t sf)
 void TheThingsNetwork::sendCommand(uint8_t table, uint8_t index, bool appendSpace, bool print)
 {
   char command[100];
+  if (txPending || vddPending)
+  {
+    finishPending(); // the answer to the command would be mixed up with the pending result
+  }
+  if (modemAsleep)
+  {
+    wake(); // a sleeping module would lose the command
+  }
   switch (table)
   {
     case MAC_TABLE:
@@ -1997,6 +2791,23 @@ bool TheThingsNetwork::sendJoinSet(uint8_t type)
  * @return true if the payload is successfully sent and acknowledged, false otherwise.
  */
 bool TheThingsNetwork::sendPayload(uint8_t mode, uint8_t port, uint8_t *payload, size_t length)
+{
+  beginPayload(mode, port);
+#if defined(YES_DEBUG)
+  HexPrint hex(modemStream, debugStream);
+#else
+  HexPrint hex(modemStream, NULL);
+#endif
+  hex.write(payload, length);
+  return endPayload();
+}
+/**
+ * @brief Writes the mac tx command up to and including the port, the payload hex follows directly.
+ * 
+ * @param mode The transmission mode.
+ * @param port The port number.
+ */
+void TheThingsNetwork::beginPayload(uint8_t mode, uint8_t port)
 {
   clearReadBuffer();
 #if defined(YES_DEBUG)
@@ -2030,26 +2841,14 @@ bool TheThingsNetwork::sendPayload(uint8_t mode, uint8_t port, uint8_t *payload,
   debugPrint(sport);
   debugPrint(F(" "));
 #endif
-  uint8_t i = 0;
-  for (i = 0; i < length; i++)
-  {
-    if (payload[i] < 16)
-    {
-      modemStream->print("0");
-      modemStream->print(payload[i], HEX);
-#if defined(YES_DEBUG)
-      debugPrint(F("0"));
-      debugPrint(payload[i], HEX);
-#endif
-    }
-    else
-    {
-      modemStream->print(payload[i], HEX);
-#if defined(YES_DEBUG)
-      debugPrint(payload[i], HEX);
-#endif
-    }
-  }
+}
+/**
+ * @brief Terminates the mac tx command started by beginPayload() and waits for the modem to accept it.
+ * 
+ * @return true if the payload is acknowledged, false otherwise.
+ */
+bool TheThingsNetwork::endPayload()
+{
   modemStream->write(SEND_MSG);
   debugPrintLn();
   return waitForOk();
@@ -2081,15 +2880,115 @@ void TheThingsNetwork::sleep(uint32_t mseconds)
 #if defined(YES_DEBUG)
   debugPrintLn(buffer);
 #endif
+  modemAsleep = true;
+  modemSleepEnd = clock() + mseconds;
 }
 /**
  * @brief Wakes up the LoRaWAN module.
  * 
- * This function wakes up the LoRaWAN module from sleep mode by performing an auto-baud process.
+ * This function wakes up the LoRaWAN module from sleep mode with a single sync sequence and a short
+ * probe. Only when the module does not answer within TTN_FAST_WAKE_TIMEOUT, the full auto-baud process
+ * runs.
  */
 void TheThingsNetwork::wake()
 {
-  autoBaud();
+  uint32_t start = micros();
+  modemAsleep = false;
+  if (!fastWake())
+  {
+    autoBaud();
+  }
+  wakeLatency = micros() - start;
+}
+/**
+ * @brief Gets the duration of the last wake-up of the LoRaWAN module.
+ * 
+ * Time from the start of wake() or startGetVDD() until the module answered, including the full auto-baud
+ * process when the fast path failed.
+ * 
+ * @return The wake latency in microseconds, 0 before the first wake().
+ */
+uint32_t TheThingsNetwork::getWakeLatency()
+{
+  return wakeLatency;
+}
+/**
+ * @brief Sets the function that puts the MCU to sleep in sleepAll().
+ * 
+ * @param cb Pointer to the sleep function, e.g. a wrapper around KISSLoRa_sleep_delay_ms().
+ * @note The callback function should have the following signature:
+ * @code
+ * void callback(uint32_t mseconds)
+ * @endcode
+ */
+void TheThingsNetwork::onSleep(void (*cb)(uint32_t mseconds))
+{
+  sleepCallback = cb;
+}
+/**
+ * @brief Sets the clock used for the timeouts of the library.
+ * 
+ * millis() stops while the MCU sleeps in power down, so a timeout that spans a sleep would be too long.
+ * An application that sleeps sets a clock that adds the slept time, e.g. KISSLoRa_sleep_millis(), and
+ * uses the same clock for its own timing. Short waits inside one command (stream timeouts, delays) never
+ * span a sleep and keep using millis().
+ * 
+ * @param cb Function returning milliseconds that wrap like millis(); NULL selects millis() again.
+ */
+void TheThingsNetwork::setClock(unsigned long (*cb)(void))
+{
+  clock = cb ? cb : millis;
+}
+/**
+ * @brief Puts the LoRaWAN module and the MCU to sleep for the same time.
+ * 
+ * The module sleeps the guard time longer than the MCU, so it never wakes before the MCU and the two
+ * sleep timers cannot drift apart. It stays asleep after the MCU wakes and is woken by
+ * the next command that needs it, e.g. the next sendBytes(). The sleep command is confirmed instead of
+ * waiting a fixed delay: the MCU waits until the command has been transmitted and then at most
+ * TTN_SLEEP_CONFIRM_TIMEOUT ms for a rejection. A module that still sleeps from an earlier call is not
+ * woken, and a module that is sending (isSending()) is not put to sleep; only the MCU sleeps then.
+ * An earlier sleep that has run out by the clock counts as awake even when its "ok" was lost, e.g. to
+ * a power down wake-up of the MCU: the module is woken and put to sleep again.
+ * 
+ * @param mseconds The duration of sleep time of the MCU in milliseconds.
+ * @param guard The error bound of the MCU sleep in milliseconds, e.g. from the calibrated sleep timer;
+ *              0 uses mseconds / TTN_SLEEP_GUARD_DIVISOR.
+ * @return true if the module sleeps, false if it rejected the sleep command or mseconds is below 100.
+ * @note The MCU sleeps with the function set by onSleep(), without it only the module sleeps.
+ */
+bool TheThingsNetwork::sleepAll(uint32_t mseconds, uint32_t guard)
+{
+  bool asleep = modemAsleep;
+  if (asleep && (long)(clock() - modemSleepEnd) >= 0)
+  {
+    wake(); // the earlier sleep ran out without a complete "ok" line
+    asleep = false;
+  }
+  if (!asleep && !txPending && mseconds >= 100)
+  {
+    clearReadBuffer();
+    sleep(mseconds + (guard ? guard : mseconds / TTN_SLEEP_GUARD_DIVISOR));
+    // The sleep command has no answer; an error comes within a few ms after the command is sent.
+    modemStream->flush();
+    modemStream->setTimeout(TTN_SLEEP_CONFIRM_TIMEOUT);
+    size_t read = modemStream->readBytesUntil('\n', buffer, sizeof(buffer));
+    modemStream->setTimeout(TTN_DEFAULT_TIMEOUT);
+    modemAsleep = read == 0;
+    asleep = modemAsleep;
+#if defined(YES_DEBUG)
+    if (!asleep)
+    {
+      buffer[read - 1] = '\0';
+      debugPrintMessage(ERR_MESSAGE, ERR_UNEXPECTED_RESPONSE, buffer);
+    }
+#endif
+  }
+  if (sleepCallback)
+  {
+    sleepCallback(mseconds);
+  }
+  return asleep;
 }
 /**
  * @brief Configures the link check mechanism of the LoRaWAN module.
@@ -57,9 +57,14 @@ Go to **Tools->Processor** and select **ATmega32U4 (3.3V, 8MHz)**.
 //#include "TheThingsNetwork.h"
 #include "TheThingsNetwork_IOT.h"
 #include <CayenneLPP.h>         // include for Cayenne library
+#include "CompactPayload.hpp"   // include for header-less compact payload
+#include "DownlinkCommands.hpp" // include for typed downlink commands
+#include "EventRing.hpp"        // include for the interrupt event queue
 #include "SparkFun_Si7021_Breakout_Library.h" // include for temperature and humidity sensor
 #include <Wire.h>
 #include "KISSLoRa_sleep.h"     // Include to sleep MCU
+#include "KISSLoRa_scheduler.h" // Include for the tickless task scheduler
+#include "KISSLoRa_power.h"     // Include for the peripheral power profiles
 
 #define USB_CABLE_CONNECTED (USBSTA&(1<<VBUS))
 
@@ -97,6 +102,28 @@ TheThingsNetwork ttn(loraSerial, debugSerial);//edited version
 
 CayenneLPP lpp(LPP_PAYLOAD_MAX_SIZE); ///< Cayenne object for composing sensor message
 
+// Compact payload
+#define USE_COMPACT_PAYLOAD       0    ///< Set to 1 to send the regular frame in compact format instead of CayenneLPP
+#define APPLICATION_PORT_COMPACT  100  ///< LoRaWAN port to which compact packets shall be sent
+#define COMPACT_SCHEMA_KISSLORA   1    ///< Schema ID of the regular KISSLoRa frame
+
+/// Layout of the regular KISSLoRa frame: 98 bits + schema ID = 14 bytes instead of 33 bytes CayenneLPP
+const PAYLOAD_ENCODER::CompactField kissloraFields[] = {
+  {-400, 10,   11},   ///< Temperature -40.0..164.7 degrees
+  {0,    10,   10},   ///< Humidity 0.0..102.3 %RH
+  {0,    1,    16},   ///< Luminosity 0..65535 lux
+  {0,    1,    4},    ///< Rotary switch 0..15
+  {-2000, 1000, 12},  ///< Acceleration x -2.000..2.095 g
+  {-2000, 1000, 12},  ///< Acceleration y
+  {-2000, 1000, 12},  ///< Acceleration z
+  {180,  100,  8},    ///< RN2483 voltage 1.80..4.35 Volt
+  {0,    1,    1},    ///< Presence
+  {0,    1,    12}    ///< Interval 0..4095 seconds
+};
+const PAYLOAD_ENCODER::CompactSchema kissloraSchema = {COMPACT_SCHEMA_KISSLORA, sizeof(kissloraFields) / sizeof(kissloraFields[0]), kissloraFields};
+
+PAYLOAD_ENCODER::CompactEncoder<LPP_PAYLOAD_MAX_SIZE> compact(LPP_PAYLOAD_MAX_SIZE); ///< Compact object for composing sensor message
+
 // Sensors
 Weather sensor;                  ///< temperature and humidity sensor
 
@@ -121,6 +148,11 @@ Weather sensor;                  ///< temperature and humidity sensor
 #define ACC_RANGE         2       ///< Set up to read the accelerometer values in range -2g to +2g - valid ranges: �2G,�4G or �8G
 
 float x,y,z;                      ///< Variables to hold acellerometer axis values.
+float humidity;                   ///< Last sampled relative humidity in %RH
+float temperature;                ///< Last sampled temperature in degrees
+float luminosity;                 ///< Last sampled luminosity in lux
+uint8_t rotaryPosition;           ///< Last sampled rotary encoder position
+float vdd;                        ///< Last sampled RN2483 voltage in Volt
 
 // Set up application specific
 #define REGULAR_INTERVAL  60000   ///< Regular transmission interval in ms
@@ -139,7 +171,50 @@ float x,y,z;                      ///< Variables to hold acellerometer axis valu
 uint32_t currentInterval = REGULAR_INTERVAL;
 uint32_t nextInterval    = REGULAR_INTERVAL;
 
-bool alarm = { false };           ///< Variable to hold alarm state when set in ISR from button.
+// Scheduler tasks, tasks with a slack run early to share the wake-up of another task
+#define LINK_CHECK_INTERVAL 3600000UL ///< Link check report interval in ms
+#define DEBUG_INTERVAL      300000UL  ///< Scheduler statistics interval in ms
+
+uint8_t sampleTask;               ///< Task id: measure all sensors
+uint8_t uplinkTask;               ///< Task id: send the regular message
+uint8_t linkCheckTask;            ///< Task id: report the link check result
+uint8_t debugTask;                ///< Task id: print scheduler statistics and flush the debug output
+uint8_t eventTask;                ///< Task id: handle the events of the interrupts, triggered by every post
+uint8_t alarmTask;                ///< Task id: retry an alarm the duty cycle held back, runs while one is pending
+
+volatile bool buttonArmed = false;  ///< The button interrupt is attached
+
+// Events of the interrupts, the ISRs post them and handleEvents() takes them in order after the wake-up
+#define EVENT_BUTTON        1     ///< The push button was pressed
+#define EVENT_MODEM_OUTPUT  2     ///< RN2483 output woke the MCU
+
+/// \brief event posted by an ISR
+struct WakeEvent {
+  uint8_t type;         ///< EVENT_*
+  unsigned long time;   ///< KISSLoRa_sleep_millis() when the ISR ran
+};
+PAYLOAD_ENCODER::EventRing<WakeEvent, 8> events; ///< Lock-free queue from the ISRs to the main loop
+
+#define ALARM_RETRIES 3               ///< Retransmissions of an unacknowledged alarm
+#define ALARM_RETRY_INTERVAL 10000    ///< ms between attempts of an alarm the duty cycle held back, the MCU sleeps between them
+unsigned long alarmLatencyMax = 0;    ///< Largest time in ms from a button press to the start of the alarm uplink
+bool alarmPending = false;            ///< An alarm waits for duty-cycle budget, regular uplinks are held back
+unsigned long alarmTime;              ///< KISSLoRa_sleep_millis() of the button press of the pending alarm
+
+// Downlink commands, several can be sent in one downlink on port APPLICATION_PORT_COMMANDS
+#define APPLICATION_PORT_COMMANDS 99    ///< LoRaWAN port on which downlink commands are received
+#define COMMAND_SET_INTERVAL      0x14  ///< Interval in units of 10 ms (U16)
+#define COMMAND_SET_LEDS          0x15  ///< RGB LED red, green and blue on (1) or off (0) (3x U8)
+#define COMMAND_MAX_ID            0x15  ///< Highest command ID, size of the dispatch table - 1
+
+void setIntervalCommand(const PAYLOAD_ENCODER::CommandArguments &arguments);
+void setLedsCommand(const PAYLOAD_ENCODER::CommandArguments &arguments);
+
+const PAYLOAD_ENCODER::CommandSpec downlinkCommands[] = {
+  {COMMAND_SET_INTERVAL, 1, {PAYLOAD_ENCODER::ARGUMENT_TYPES::U16}, setIntervalCommand},
+  {COMMAND_SET_LEDS,     3, {PAYLOAD_ENCODER::ARGUMENT_TYPES::U8, PAYLOAD_ENCODER::ARGUMENT_TYPES::U8, PAYLOAD_ENCODER::ARGUMENT_TYPES::U8}, setLedsCommand}
+};
+PAYLOAD_ENCODER::CommandDecoder<COMMAND_MAX_ID> commandDecoder(downlinkCommands, 2); ///< Dispatches received downlink commands
 
 // \brief setup
 void setup(){
@@ -171,10 +246,11 @@ void setup(){
   pinMode(BUTTON_PIN, INPUT);     //Set pin as inputs
   digitalWrite(BUTTON_PIN, 0);    //Disable pullup resistors
   //Attach an interrupt to the button pin - fire when button pressed down.
-  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), buttonPressedISR, FALLING);
+  armButton();
 
   //Initialize the I2C Si7021 sensor
   sensor.begin();
+  sensor.setSleep(sleepSensor);     // Sleep during the conversions
 
   // Wait a maximum of 10s for Serial Monitor
   while (!debugSerial && millis() < 10000);
@@ -193,6 +269,8 @@ void setup(){
   digitalWrite(RGBLED_RED, LOW);    //switch RGBLED_RED LED on
     
   ttn.onMessage(message);           // Set callback for incoming messages
+  ttn.onSleep(sleepMcu);            // Set MCU sleep function for ttn.sleepAll()
+  ttn.setClock(KISSLoRa_sleep_millis); // Library timeouts include the time spent in power down
   ttn.reset(true);                  // Reset LoRaWAN mac and enable ADR
   
   debugSerial.println(F("-- STATUS"));
@@ -203,17 +281,69 @@ void setup(){
 
   // initilize interval from rotary switch
   nextInterval = getInitialInterval((uint8_t)getRotaryPosition());
+  currentInterval = nextInterval;
+
+  // let the RN2483 add a link check request to uplinks
+  ttn.linkCheck(LINK_CHECK_INTERVAL/1000);
+
+  // Sampling and uplink share their wake-up, link check and debug output ride along with them
+  sampleTask    = KISSLoRa_scheduler_add(sampleSensors, currentInterval, 0, 0);
+  uplinkTask    = KISSLoRa_scheduler_add(sendUplink, currentInterval, 0, 0);
+  linkCheckTask = KISSLoRa_scheduler_add(reportLinkCheck, LINK_CHECK_INTERVAL, LINK_CHECK_INTERVAL/2, LINK_CHECK_INTERVAL);
+  debugTask     = KISSLoRa_scheduler_add(flushDebug, DEBUG_INTERVAL, DEBUG_INTERVAL/2, DEBUG_INTERVAL);
+  eventTask     = KISSLoRa_scheduler_add(handleEvents, 0, 0, 0);
+  alarmTask     = KISSLoRa_scheduler_add(retryAlarm, 0, 0, 0);
+
+  // RN2483 output ends the power down sleep
+  KISSLoRa_sleep_wake_on_rx(modemOutputISR);
 
   digitalWrite(RGBLED_RED, HIGH);   //switch RGBLED_RED LED off when join succeeds
 }
 
 // \brief mainloop
 void loop(){
+  // Run the due tasks
+  unsigned long wait = KISSLoRa_scheduler_run();
+
+  // The button interrupt is level triggered, attach it again once the button is released
+  if(!buttonArmed && digitalRead(BUTTON_PIN)){
+    armButton();
+  }
+
+  // Wait for the result of the uplink, the RN2483 output wakes the MCU; downlinks go to message()
+  if(ttn.isSending()){
+    if(!USB_CABLE_CONNECTED){
+      KISSLoRa_sleep_until_rx(wait < TTN_DEFAULT_TIMEOUT ? wait : TTN_DEFAULT_TIMEOUT);
+    }
+    ttn.process();
+    return;
+  }
+
+  digitalWrite(LED_LORA, HIGH);  //switch LED_LORA LED off
+
+  // Set RN2483 and KISSLoRa to sleep until the next deadline or until the push button is pressed.
+  // The RN2483 stays asleep until a task sends the next command to it, it sleeps longer than the
+  // MCU by the expected error of the WDT sleep.
+  ttn.sleepAll(wait, KISSLoRa_sleep_error_ms(wait));
+}
+
+/// \brief MCU sleep function for ttn.sleepAll()
+/// \param mseconds time until the next deadline, the scheduler sleeps exactly until that deadline
+void sleepMcu(uint32_t mseconds){
+  KISSLoRa_scheduler_sleep(!USB_CABLE_CONNECTED);
+}
+
+/// \brief task: measure all sensors
+/// Runs in the sensor-read power profile, the timers that are not needed are off.
+void sampleSensors(){
+  KISSLoRa_power_profile_t previous = KISSLoRa_power_set(KISSLORA_POWER_SENSOR_READ);
   debugSerial.println(F("-- LOOP"));
 
   if(currentInterval != nextInterval){
     debugSerial.print("Next interval set to: " + String(nextInterval/1000));
     debugSerial.println(F(" Seconds"));    
+    KISSLoRa_scheduler_set_period(sampleTask, nextInterval);
+    KISSLoRa_scheduler_set_period(uplinkTask, nextInterval);
   }
   currentInterval = nextInterval;
   
@@ -221,34 +351,59 @@ void loop(){
   digitalWrite(RGBLED_GREEN, HIGH); //switch RGBLED_GREEN LED off
   digitalWrite(RGBLED_BLUE, HIGH);  //switch RGBLED_BLUE LED off
 
-  // Measure Relative Humidity from the Si7021
-  float humidity = sensor.getRH();
+  // Start the slow items first, they run in parallel: the Si7021 conversion and the RN2483 wake-up
+  // with the VDD query. The awake time is bounded by the slowest item instead of the sum.
+  unsigned long cycleStart = micros();
+  sensor.startMeasurement(HUMD_MEASURE_NOHOLD);
+  ttn.startGetVDD();
+  unsigned long startTime = micros() - cycleStart;
+
+  // Measure the fast items meanwhile
+  luminosity = get_lux_value();
+  rotaryPosition = (uint8_t)getRotaryPosition();
+  getAcceleration(&x, &y, &z);
+  unsigned long localTime = micros() - cycleStart;
+
+  // Collect the slow items as they complete
+  bool climateDone = false;
+  unsigned long climateTime = 0;
+  unsigned long radioTime = 0;
+  while(!climateDone || ttn.isVDDPending()){
+    if(!climateDone && (sensor.isReady() || !ttn.isVDDPending())){
+      // sleeps for the rest of the conversion when the RN2483 has answered
+      humidity = sensor.readResult();
+      // Temperature is measured every time RH is requested,
+      // read it from the previous RH measurement
+      sensor.startMeasurement(TEMP_PREV);
+      temperature = sensor.readResult();
+      climateDone = true;
+      climateTime = micros() - cycleStart;
+    }
+    if(ttn.isVDDPending()){
+      ttn.process();
+      if(!ttn.isVDDPending()){
+        radioTime = micros() - cycleStart;
+      }
+    }
+  }
+  vdd = (float)ttn.getLastVDD()/1000;
+  unsigned long cycleTime = micros() - cycleStart;
+
   debugSerial.print(F("Humidity: "));
   debugSerial.print(humidity);
   debugSerial.println(F(" %RH."));
 
-  // Measure Temperature from the Si7021
-  float temperature = sensor.getTemp();
-  // Temperature is measured every time RH is requested.
-  // It is faster, therefore, to read it from previous RH
-  // measurement with getTemp() instead with readTemp()
   debugSerial.print(F("Temperature: "));
   debugSerial.print(temperature);
   debugSerial.println(F(" Degrees."));
 
-  // Measure luminosity
-  float luminosity = get_lux_value();
   Serial.print(F("Ambient light: "));
   Serial.print(luminosity);
   Serial.println(F(" lux"));
 
-  // get rotary encode position
-  uint8_t rotaryPosition = (uint8_t)getRotaryPosition();
   Serial.print(F("Rotary encoder position: "));
   Serial.println(rotaryPosition);
 
-  /// get accelerometer
-  getAcceleration(&x, &y, &z);
   Serial.print(F("Acceleration:\tx="));
   Serial.print(x);
   Serial.print(F("g\n\t\ty="));
@@ -257,15 +412,62 @@ void loop(){
   Serial.print(z);
   Serial.println(F("g"));
 
-  /// get VDD form RN module
-  float vdd = (float)ttn.getVDD()/1000;
   Serial.print(F("RN2483 voltage: "));
   Serial.print(vdd);
   Serial.println(F(" Volt"));
-  
-  // Wake RN2483 
-  ttn.wake();
-  
+
+  // Time of every phase from the start of the cycle
+  Serial.print(F("Cycle: started "));
+  Serial.print(startTime);
+  Serial.print(F(" us, local sensors "));
+  Serial.print(localTime);
+  Serial.print(F(" us, Si7021 "));
+  Serial.print(climateTime);
+  Serial.print(F(" us, RN2483 "));
+  Serial.print(radioTime);
+  Serial.print(F(" us, total "));
+  Serial.print(cycleTime);
+  Serial.println(F(" us"));
+
+  KISSLoRa_power_set(previous);
+}
+
+/// \brief sleep function for the Si7021 conversion
+/// Power down sleeps in whole 16 ms WDT periods only, the rest is waited awake while the sensor is polled.
+/// \param ms rest of the conversion time
+void sleepSensor(unsigned long ms){
+  if(ms >= 16 && !USB_CABLE_CONNECTED){
+    KISSLoRa_sleep_delay_ms(ms & ~15UL);
+  }
+}
+
+/// \brief task: send the last sampled values
+/// Skipped while an alarm waits for duty-cycle budget, the regular uplink would use it up first.
+void sendUplink(){
+  if(alarmPending){
+    debugSerial.println(F("Uplink held back for the pending alarm"));
+    return;
+  }
+  // The RN2483 is woken by the first command
+#if USE_COMPACT_PAYLOAD == 1
+  // Compose compact message, fields in the order of kissloraFields
+  compact.reset(kissloraSchema);
+  compact.add(temperature);
+  compact.add(humidity);
+  compact.add(luminosity);
+  compact.addScaled(rotaryPosition);
+  compact.add(x);
+  compact.add(y);
+  compact.add(z);
+  compact.add(vdd);
+  compact.addScaled(SAFE);
+  compact.addScaled(currentInterval/1000);
+
+  digitalWrite(LED_LORA, LOW);  //switch LED_LORA LED on
+
+  // send compact message on port 100, the result is handled in loop()
+  ttn.startSendBytes(compact.getBuffer(), compact.getSize(), APPLICATION_PORT_COMPACT);
+#else
   // Compose Cayenne message
   lpp.reset();    // reset cayenne object
 
@@ -281,19 +483,121 @@ void loop(){
   
   digitalWrite(LED_LORA, LOW);  //switch LED_LORA LED on
 
-  // send cayenne message on port 99
-  ttn.sendBytes(lpp.getBuffer(), lpp.getSize(), APPLICATION_PORT_CAYENNE);
+  // send cayenne message on port 99, the result is handled in loop()
+  ttn.startSendBytes(lpp.getBuffer(), lpp.getSize(), APPLICATION_PORT_CAYENNE);
+#endif
+}
 
-  // Set RN2483 to sleep mode
-  ttn.sleep(currentInterval - 100);
-  // This delay is not optional, try to remove it
-  // and say bye bye to your RN2483 sleep mode
-  delay(50);
+/// \brief task: print the result of the last link check
+void reportLinkCheck(){
+  Serial.print(F("Link check: "));
+  Serial.print(ttn.getLinkCheckGateways());
+  Serial.print(F(" gateways, margin "));
+  Serial.print(ttn.getLinkCheckMargin());
+  Serial.println(F(" dB"));
+}
 
-  digitalWrite(LED_LORA, HIGH);  //switch LED_LORA LED off
+/// \brief task: print the scheduler statistics and write out the debug output before sleeping
+void flushDebug(){
+  KISSLoRa_scheduler_stats_t stats;
+  KISSLoRa_scheduler_get_stats(&stats);
+  debugSerial.print(F("Scheduler: "));
+  debugSerial.print(stats.wakeups);
+  debugSerial.print(F(" wake-ups, "));
+  debugSerial.print(stats.runs);
+  debugSerial.print(F(" runs, "));
+  debugSerial.print(stats.coalesced);
+  debugSerial.print(F(" coalesced, max lateness "));
+  debugSerial.print(stats.maxLateness);
+  debugSerial.print(F(" ms, wake margin "));
+  debugSerial.print(stats.wakeMargin);
+  debugSerial.print(F(" ms, sleep error per minute "));
+  debugSerial.print(KISSLoRa_sleep_error_ms(60000));
+  debugSerial.print(F(" ms, RN2483 wake "));
+  debugSerial.print(ttn.getWakeLatency());
+  debugSerial.print(F(" us, dropped events "));
+  debugSerial.print(events.getDroppedCount());
+  debugSerial.print(F(", max alarm latency "));
+  debugSerial.print(alarmLatencyMax);
+  debugSerial.println(F(" ms"));
+
+  // time in every power profile and the charge estimated from the measured currents
+  debugSerial.print(F("Power:"));
+  for (uint8_t i = 0; i < KISSLORA_POWER_PROFILES; i++) {
+    debugSerial.print(' ');
+    debugSerial.print(KISSLoRa_power_name((KISSLoRa_power_profile_t)i));
+    debugSerial.print(' ');
+    debugSerial.print(KISSLoRa_power_time_ms((KISSLoRa_power_profile_t)i)/1000);
+    debugSerial.print(F(" s"));
+    if (KISSLoRa_power_current_ua((KISSLoRa_power_profile_t)i) == 0) {
+      debugSerial.print(F(" (not measured, not in the estimate)"));
+    }
+    debugSerial.print(',');
+  }
+  debugSerial.print(F(" used "));
+  debugSerial.print(KISSLoRa_power_charge_mah(), 3);
+  debugSerial.println(F(" mAh"));
+  debugSerial.flush();
+}
+
+/// \brief send acknowledged message at alarm, called for a button event.
+/// The alarm goes out on the urgent path before any other uplink, the latency from the button press to
+/// the start of the transmission is printed. When the duty cycle holds it back, it stays pending and
+/// retryAlarm() sends it again every ALARM_RETRY_INTERVAL ms while the MCU and the RN2483 sleep. The 1% duty
+/// cycle can hold it back for up to 4.6 minutes after a regular uplink at SF12, plus one retry interval.
+/// \param eventTime KISSLoRa_sleep_millis() of the button press
+void sendAlarm(unsigned long eventTime){
+  if(alarmPending){
+    eventTime = alarmTime;  // a press while the alarm is pending is the same alarm, measure from the first one
+  }
+  lpp.reset();
+  lpp.addPresence(LPP_CH_PRESENCE, ALARM);
+  lpp.addDigitalInput(LPP_CH_SW_RELEASE, RELEASE);
   
-  // Set KISSLoRa to sleep.
-  sleep(currentInterval);
+  // Send it off
+  ttn_response_t result = ttn.sendUrgent(lpp.getBuffer(), lpp.getSize(), APPLICATION_PORT_CAYENNE, true, ALARM_RETRIES);
+
+  if(result == TTN_ERROR_DEFERRED){
+    if(!alarmPending){
+      alarmPending = true;
+      alarmTime = eventTime;
+      KISSLoRa_scheduler_set_period(alarmTask, ALARM_RETRY_INTERVAL);
+      debugSerial.println(F("Alarm deferred by the duty cycle"));
+    }
+    return;
+  }
+  if(alarmPending){
+    alarmPending = false;
+    KISSLoRa_scheduler_set_period(alarmTask, 0);  // runs once more and finds nothing pending
+  }
+
+  digitalWrite(RGBLED_RED, LOW);  //switch RGBLED_RED LED on
+  debugSerial.println(F("-- ALARM!"));
+  if(result < 0){
+    // not transmitted, no airtime
+    debugSerial.print(F("Alarm failed: "));
+    debugSerial.println(result);
+  } else {
+    unsigned long latency = ttn.getTxStartTime() - eventTime;
+    debugSerial.print(F("Alarm latency: "));
+    debugSerial.print(latency);
+    debugSerial.print(F(" ms to airtime, RN2483 wake "));
+    debugSerial.print(ttn.getWakeLatency());
+    debugSerial.print(F(" us, result "));
+    debugSerial.println(result);
+    if(latency > alarmLatencyMax){
+      alarmLatencyMax = latency;
+    }
+  }
+  
+  digitalWrite(RGBLED_RED, HIGH);  //switch RGBLED_RED LED off
+}
+
+/// \brief task: send the alarm again that the duty cycle held back
+void retryAlarm(){
+  if(alarmPending){
+    sendAlarm(alarmTime);
+  }
 }
 
 /// \brief function called at RX message
@@ -307,16 +611,8 @@ void message(const uint8_t *payload, size_t size, port_t port)
 
   switch(port)
   {
-    case 99:
-      if(payload[0] == 0x14){
-        uint32_t tempValue = 0;
-        tempValue |= payload[1] << 8;
-        tempValue |= payload[2];
-        nextInterval = tempValue * 10;
-        debugSerial.print("New interval: " + String(nextInterval/1000));
-        debugSerial.println(F(" Seconds"));
-        digitalWrite(RGBLED_BLUE, !digitalRead(RGBLED_BLUE));
-      }else{
+    case APPLICATION_PORT_COMMANDS:
+      if(commandDecoder.dispatch(payload, size) != PAYLOAD_ENCODER::COMMAND_ERRORS::COMMAND_OK){
         debugSerial.println(F("Wrong downlink message."));
       }
       break;
@@ -333,6 +629,25 @@ void message(const uint8_t *payload, size_t size, port_t port)
   }
 }
 
+/// \brief downlink command: set the transmission interval
+/// \param arguments interval in units of 10 ms
+void setIntervalCommand(const PAYLOAD_ENCODER::CommandArguments &arguments)
+{
+  nextInterval = arguments.getUnsigned(0) * 10;
+  debugSerial.print("New interval: " + String(nextInterval/1000));
+  debugSerial.println(F(" Seconds"));
+  digitalWrite(RGBLED_BLUE, !digitalRead(RGBLED_BLUE));
+}
+
+/// \brief downlink command: switch the RGB LED
+/// \param arguments red, green and blue, 1 is on
+void setLedsCommand(const PAYLOAD_ENCODER::CommandArguments &arguments)
+{
+  digitalWrite(RGBLED_RED,   arguments.getUnsigned(0) ? LOW : HIGH);
+  digitalWrite(RGBLED_GREEN, arguments.getUnsigned(1) ? LOW : HIGH);
+  digitalWrite(RGBLED_BLUE,  arguments.getUnsigned(2) ? LOW : HIGH);
+}
+
 /// \brief read luminosty value from sensor
 ///  Get the lux value from the APDS-9007 Ambient Light Photo Sensor
 /// \return luminosity in Lux.
@@ -356,9 +671,52 @@ int8_t getRotaryPosition(){
   return value;
 }
 
+/// \brief handle RN2483 output that woke the MCU from power down
+/// The first characters of the line are lost during the wake-up, the parser skips the damaged line.
+void handleModemOutput(){
+  ttn.process();
+}
+
+/// \brief task: handle all events posted by the ISRs, in the order they happened
+void handleEvents(){
+  WakeEvent event;
+  while(events.take(event)){
+    switch(event.type){
+      case EVENT_BUTTON:
+        sendAlarm(event.time);
+        break;
+      case EVENT_MODEM_OUTPUT:
+        handleModemOutput();
+        break;
+    }
+  }
+}
+
+/// \brief post an event from an ISR and run handleEvents() at once, ends the current sleep
+/// \param type EVENT_*
+void postEvent(uint8_t type){
+  WakeEvent event = {type, KISSLoRa_sleep_millis()};
+  events.post(event);
+  KISSLoRa_scheduler_trigger(eventTask);
+}
+
+/// \brief function called when RN2483 output woke the MCU
+void modemOutputISR(){
+  postEvent(EVENT_MODEM_OUTPUT);
+}
+
+/// \brief attach the level triggered button interrupt, only a level interrupt wakes the MCU from power down
+void armButton(){
+  buttonArmed = true;
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), buttonPressedISR, LOW);
+}
+
 /// \brief function called at interrupt generated by pushbutton
 void buttonPressedISR(){
-  alarm = true;
+  // detach until the button is released, the level interrupt would fire again and again
+  detachInterrupt(digitalPinToInterrupt(BUTTON_PIN));
+  buttonArmed = false;
+  postEvent(EVENT_BUTTON);
 }
 
 /// \brief Write one register to the acceleromter
@@ -442,53 +800,6 @@ void getAcceleration(float *x, float *y, float *z){
   *z = (float)*z / (float)(1<<11) * (float)(ACC_RANGE);
 }
 
-/// \brief Sleep until a given time has passed, or if the push button is pressed, or if rotary switch is changed
-/// During sleep the function will observe for interrupt by button.
-/// \param delay_time_ms time in ms to sleep.
-static void sleep(uint32_t delay_time_ms){
-  //Loop until delay is over, or if the push button is pressed, or if rotary switch is changed
-  while (delay_time_ms)
-  {
-    if(!USB_CABLE_CONNECTED){
-      KISSLoRa_sleep_delay_ms(100);
-    }else{
-      delay(100);
-    }
-
-    // Event: Send acknowledged message at alarm.
-    if(alarm){
-      debugSerial.println(F("-- ALARM!"));
-      digitalWrite(RGBLED_RED, LOW);  //switch RGBLED_RED LED on
-
-      // Wake RN2483 
-      ttn.wake();
-        
-      lpp.reset();
-      lpp.addPresence(LPP_CH_PRESENCE, ALARM);
-      lpp.addDigitalInput(LPP_CH_SW_RELEASE, RELEASE);
-  
-      // Send it off
-      ttn.sendBytes(lpp.getBuffer(), lpp.getSize(), APPLICATION_PORT_CAYENNE, true);
-
-      // Set RN2483 to sleep mode
-      ttn.sleep(delay_time_ms - 2200);
-      // This delay is not optional, try to remove it
-      // and say bye bye to your RN2483 sleep mode
-      delay(50);
-      
-      alarm = false;
-      
-      digitalWrite(RGBLED_RED, HIGH);  //switch RGBLED_RED LED off
-    }
-
-    if(delay_time_ms > 100){
-      delay_time_ms -= 100;
-    }else{
-      delay_time_ms = 0;
-    }
-  }
-}
-
 /// \brief Determine interval in ms using rotary value
 /// \pre This function is only using bits 4, 2, and 1 while ignoring bit 8.
 /// Set this using define INTERVAL_ROTARY_MASK
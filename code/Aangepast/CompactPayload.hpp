@@ -0,0 +1,296 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef COMPACT_PAYLOAD_HPP
+#define COMPACT_PAYLOAD_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Declaration of one field in a compact payload schema.
+     *
+     * A value is stored as (scaled - minimum) in a fixed number of bits, where scaled is the value
+     * in units of 1/resolution. Values outside the range are clamped.
+     * Example: temperature -40.0..+87.9 °C at 0.1 °C is {-400, 10, 11}.
+     */
+    struct CompactField
+    {
+        int32_t minimum;        /**< Lowest scaled value that can be stored. */
+        uint16_t resolution;    /**< Scaled units per unit, e.g. 10 for 0.1 °C. */
+        uint8_t bits;           /**< Number of bits used for this field (1..32). */
+    };
+
+    /**
+     * @brief A compact payload layout. The ID is sent as the first byte of every frame.
+     */
+    struct CompactSchema
+    {
+        uint8_t id;                     /**< Schema ID, sent as the first byte. */
+        uint8_t fieldCount;             /**< Number of fields in the schema. */
+        const CompactField *fields;     /**< The fields, in the order they are packed. */
+    };
+
+    /**
+     * @brief Calculates the frame size of a schema, including the schema ID byte.
+     * @param schema The schema.
+     * @return size_t The frame size in bytes.
+     */
+    static inline size_t getCompactFrameSize(const CompactSchema &schema)
+    {
+        size_t bits = 0;
+        for (uint8_t i = 0; i < schema.fieldCount; i++)
+        {
+            bits += schema.fields[i].bits;
+        }
+        return 1 + (bits + 7) / 8;
+    }
+
+    /**
+     * @brief Returns the largest raw value a field can hold.
+     * @param field The field.
+     * @return uint32_t The all-ones value for the field width.
+     */
+    static inline uint32_t getCompactFieldMask(const CompactField &field)
+    {
+        return field.bits >= 32 ? 0xFFFFFFFFUL : ((1UL << field.bits) - 1);
+    }
+
+    /**
+     * @brief Template class for the header-less, bit-packed payload encoder.
+     *
+     * Where CayenneLPP spends a type and channel byte on every field, this encoder only sends one
+     * schema ID byte per frame and packs the values MSB first using the bit widths declared in the
+     * schema. Fields must be added in schema order. Use a different LoRaWAN port than for CayenneLPP
+     * so the backend can tell both formats apart.
+     *
+     * @tparam MaxSize Maximum size of the buffer.
+     */
+    template <size_t MaxSize>
+    class CompactEncoder
+    {
+    public:
+        /**
+         * @brief Constructor for CompactEncoder.
+         *
+         * @param size Size of the buffer.
+         */
+        explicit CompactEncoder(const uint8_t size) : operationalSize(size > MaxSize ? MaxSize : size), schema(nullptr), fieldIndex(0), bitIndex(0) {}
+
+        /**
+         * @brief Starts a new frame with the given schema and writes the schema ID.
+         *
+         * @param frameSchema The schema of the frame. Must stay valid until the frame is complete.
+         * @return bool Returns false if the schema does not fit in the buffer.
+         */
+        bool reset(const CompactSchema &frameSchema)
+        {
+            schema = nullptr;
+            fieldIndex = 0;
+            bitIndex = 0;
+            if (getCompactFrameSize(frameSchema) > operationalSize)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < operationalSize; i++)
+            {
+                buffer[i] = 0;
+            }
+            schema = &frameSchema;
+            buffer[0] = frameSchema.id;
+            bitIndex = 8;
+            return true;
+        }
+
+        /**
+         * @brief Adds the next field as an integer in units of its resolution.
+         *
+         * @param scaled The value, e.g. 215 for 21.5 °C at a resolution of 10.
+         * @return uint8_t Returns the new size of the payload, or 0 if all fields have already been added.
+         */
+        const uint8_t addScaled(const int32_t scaled)
+        {
+            if (!schema || fieldIndex >= schema->fieldCount)
+            {
+                return 0;
+            }
+            const CompactField &field = schema->fields[fieldIndex++];
+            const uint32_t mask = getCompactFieldMask(field);
+            uint32_t raw;
+            if (scaled <= field.minimum)
+            {
+                raw = 0;
+            }
+            else if (static_cast<uint32_t>(scaled - field.minimum) > mask)
+            {
+                raw = mask;
+            }
+            else
+            {
+                raw = static_cast<uint32_t>(scaled - field.minimum);
+            }
+            writeBits(raw, field.bits);
+            return getSize();
+        }
+
+        /**
+         * @brief Adds the next field as a float in its unit; it is scaled with the field resolution.
+         *
+         * @param value The value, e.g. 21.5 for 21.5 °C.
+         * @return uint8_t Returns the new size of the payload, or 0 if all fields have already been added.
+         */
+        const uint8_t add(const float value)
+        {
+            if (!schema || fieldIndex >= schema->fieldCount)
+            {
+                return 0;
+            }
+            const float scaled = value * schema->fields[fieldIndex].resolution;
+            return addScaled(static_cast<int32_t>(scaled > 0 ? scaled + 0.5f : scaled - 0.5f));
+        }
+
+        /**
+         * @brief Returns whether every field of the schema has been added.
+         * @return bool True when the frame is complete.
+         */
+        bool isComplete() const
+        {
+            return schema && fieldIndex == schema->fieldCount;
+        }
+
+        /**
+         * @brief Gets the size of the payload.
+         * @return size_t Number of used bytes.
+         */
+        size_t getSize(void) const
+        {
+            return (bitIndex + 7) / 8;
+        }
+
+        /**
+         * @brief Returns the buffer.
+         * @return const uint8_t* Pointer to the buffer.
+         */
+        const uint8_t *getBuffer(void) const
+        {
+            return buffer;
+        }
+
+    private:
+        uint8_t buffer[MaxSize];
+        size_t operationalSize;
+        const CompactSchema *schema;
+        uint8_t fieldIndex;
+        uint16_t bitIndex;
+
+        /**
+         * @brief Appends the lowest bits of a value to the buffer, MSB first.
+         *
+         * @param value The value to append.
+         * @param bits Number of bits to append.
+         */
+        void writeBits(const uint32_t value, uint8_t bits)
+        {
+            while (bits--)
+            {
+                if ((value >> bits) & 1)
+                {
+                    buffer[bitIndex >> 3] |= 0x80 >> (bitIndex & 0x07);
+                }
+                bitIndex++;
+            }
+        }
+    }; // End of class CompactEncoder.
+
+    /**
+     * @brief Decoder for compact payloads, meant for the host side (or downlink tests on the device).
+     *
+     * Looks up the schema by the ID in the first byte and unpacks all fields.
+     */
+    class CompactDecoder
+    {
+    public:
+        /**
+         * @brief Constructor for CompactDecoder.
+         *
+         * @param schemas The known schemas.
+         * @param schemaCount Number of schemas.
+         */
+        CompactDecoder(const CompactSchema *schemas, const uint8_t schemaCount) : schemas(schemas), schemaCount(schemaCount) {}
+
+        /**
+         * @brief Decodes a frame into scaled integer values.
+         *
+         * @param payload The frame.
+         * @param size The size of the frame in bytes.
+         * @param values Receives one scaled value per field, in schema order.
+         * @param maxValues Capacity of values.
+         * @return const CompactSchema* The schema of the frame, or nullptr for an unknown schema ID,
+         *         a frame that is too short or too little room in values.
+         */
+        const CompactSchema *decode(const uint8_t *payload, const size_t size, int32_t *values, const uint8_t maxValues) const
+        {
+            if (!payload || size == 0)
+            {
+                return nullptr;
+            }
+            const CompactSchema *schema = findSchema(payload[0]);
+            if (!schema || schema->fieldCount > maxValues || getCompactFrameSize(*schema) > size)
+            {
+                return nullptr;
+            }
+            uint16_t bitIndex = 8;
+            for (uint8_t i = 0; i < schema->fieldCount; i++)
+            {
+                const CompactField &field = schema->fields[i];
+                uint32_t raw = 0;
+                for (uint8_t b = 0; b < field.bits; b++, bitIndex++)
+                {
+                    raw = (raw << 1) | ((payload[bitIndex >> 3] >> (7 - (bitIndex & 0x07))) & 1);
+                }
+                values[i] = static_cast<int32_t>(raw) + field.minimum;
+            }
+            return schema;
+        }
+
+        /**
+         * @brief Converts a decoded scaled value to its unit.
+         *
+         * @param field The field the value belongs to.
+         * @param scaled The scaled value from decode().
+         * @return float The value in its unit.
+         */
+        static float toFloat(const CompactField &field, const int32_t scaled)
+        {
+            return static_cast<float>(scaled) / (field.resolution ? field.resolution : 1);
+        }
+
+    private:
+        const CompactSchema *schemas;
+        uint8_t schemaCount;
+
+        /**
+         * @brief Finds a schema by ID.
+         * @param id The schema ID.
+         * @return const CompactSchema* The schema, or nullptr if unknown.
+         */
+        const CompactSchema *findSchema(const uint8_t id) const
+        {
+            for (uint8_t i = 0; i < schemaCount; i++)
+            {
+                if (schemas[i].id == id)
+                {
+                    return &schemas[i];
+                }
+            }
+            return nullptr;
+        }
+    }; // End of class CompactDecoder.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // COMPACT_PAYLOAD_HPP
@@ -0,0 +1,340 @@
+/* This code is free software:
+ * you can redistribute it and/or modify it under the terms of a Creative
+ * Commons Attribution-NonCommercial 4.0 International License
+ * (http://creativecommons.org/licenses/by-nc/4.0/)
+ */
+
+#ifndef DOWNLINK_COMMANDS_HPP
+#define DOWNLINK_COMMANDS_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace PAYLOAD_ENCODER
+{
+    /**
+     * @brief Maximum number of arguments of one command.
+     */
+    static const uint8_t COMMAND_MAX_ARGUMENTS = 4;
+
+    /**
+     * @brief Argument types of downlink commands. Bits 0..2 hold the size in bytes, bit 7 the signedness.
+     */
+    enum class ARGUMENT_TYPES : uint8_t
+    {
+        U8  = 0x01,     /* 0..255 */
+        I8  = 0x81,     /* -128..127 */
+        U16 = 0x02,     /* 0..65535 */
+        I16 = 0x82,     /* -32768..32767 */
+        U32 = 0x04,     /* 0..4294967295 */
+        I32 = 0x84      /* -2147483648..2147483647 */
+    };
+
+    /**
+     * @brief Result of decoding a downlink.
+     */
+    enum class COMMAND_ERRORS : uint8_t
+    {
+        COMMAND_OK          = 0,    /**< All commands were decoded. */
+        COMMAND_UNKNOWN     = 1,    /**< A command ID is not in the table. */
+        COMMAND_TRUNCATED   = 2     /**< The arguments of the last command run past the end of the downlink. */
+    };
+
+    /**
+     * @brief Returns the size of an argument in bytes.
+     * @param type The argument type.
+     * @return uint8_t The size in bytes.
+     */
+    static inline uint8_t getArgumentSize(const ARGUMENT_TYPES type)
+    {
+        return static_cast<uint8_t>(type) & 0x07;
+    }
+
+    struct CommandSpec;
+
+    /**
+     * @brief Typed read access to the arguments of one received command.
+     *
+     * Arguments are sent MSB first, like the original 0x14 interval command.
+     */
+    class CommandArguments
+    {
+    public:
+        /**
+         * @brief Constructor for CommandArguments.
+         *
+         * @param spec The declaration of the command.
+         * @param data The first argument byte in the downlink.
+         */
+        CommandArguments(const CommandSpec &spec, const uint8_t *data) : spec(spec), data(data) {}
+
+        /**
+         * @brief Gets an unsigned argument.
+         * @param index The argument index.
+         * @return uint32_t The value, 0 for an index out of range.
+         */
+        uint32_t getUnsigned(const uint8_t index) const;
+
+        /**
+         * @brief Gets a signed argument; unsigned types are returned as is.
+         * @param index The argument index.
+         * @return int32_t The sign extended value, 0 for an index out of range.
+         */
+        int32_t getSigned(const uint8_t index) const;
+
+    private:
+        const CommandSpec &spec;
+        const uint8_t *data;
+    };
+
+    /**
+     * @brief Function called for every received command.
+     */
+    typedef void (*CommandHandler)(const CommandArguments &arguments);
+
+    /**
+     * @brief Declaration of one downlink command: its ID, its fixed-size arguments and its handler.
+     *
+     * Example, the interval command in units of 10 ms:
+     *
+     *     {0x14, 1, {ARGUMENT_TYPES::U16}, setInterval}
+     */
+    struct CommandSpec
+    {
+        uint8_t id;                                         /**< Command ID, sent as the first byte of the command. */
+        uint8_t argumentCount;                              /**< Number of arguments (0..COMMAND_MAX_ARGUMENTS). */
+        ARGUMENT_TYPES arguments[COMMAND_MAX_ARGUMENTS];    /**< The argument types, in the order they are sent. */
+        CommandHandler handler;                             /**< Called with the arguments, may be nullptr on the encoding side. */
+    };
+
+    /**
+     * @brief Returns the size of a command including its ID byte.
+     * @param spec The command.
+     * @return uint8_t The size in bytes.
+     */
+    static inline uint8_t getCommandSize(const CommandSpec &spec)
+    {
+        uint8_t size = 1;
+        for (uint8_t i = 0; i < spec.argumentCount; i++)
+        {
+            size += getArgumentSize(spec.arguments[i]);
+        }
+        return size;
+    }
+
+    inline uint32_t CommandArguments::getUnsigned(const uint8_t index) const
+    {
+        if (index >= spec.argumentCount)
+        {
+            return 0;
+        }
+        const uint8_t *p = data;
+        for (uint8_t i = 0; i < index; i++)
+        {
+            p += getArgumentSize(spec.arguments[i]);
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < getArgumentSize(spec.arguments[index]); i++)
+        {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    inline int32_t CommandArguments::getSigned(const uint8_t index) const
+    {
+        const uint32_t value = getUnsigned(index);
+        if (index >= spec.argumentCount || !(static_cast<uint8_t>(spec.arguments[index]) & 0x80))
+        {
+            return static_cast<int32_t>(value);
+        }
+        const uint8_t bits = getArgumentSize(spec.arguments[index]) * 8;
+        if (bits < 32 && (value & (1UL << (bits - 1))))
+        {
+            return static_cast<int32_t>(value | ~((1UL << bits) - 1)); // sign extend
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    /**
+     * @brief Template class for decoding and dispatching downlinks with one or more commands.
+     *
+     * A downlink is a sequence of commands, each an ID byte followed by its arguments:
+     *
+     *     [0x14][interval MSB][interval LSB][0x15][red][green][blue]
+     *
+     * so several settings can be changed in one Class A downlink. IDs are looked up in O(1) through
+     * an index table of MaxId + 1 bytes that is built once from the command table.
+     *
+     * @tparam MaxId Highest command ID in the table; keep IDs small to keep the index table small.
+     */
+    template <uint8_t MaxId>
+    class CommandDecoder
+    {
+    public:
+        /**
+         * @brief Constructor for CommandDecoder.
+         *
+         * @param commands The command table. Must stay valid while the decoder is used.
+         * @param count Number of commands in the table (at most 254). Commands with an ID above MaxId are ignored.
+         */
+        CommandDecoder(const CommandSpec *commands, const uint8_t count) : commands(commands)
+        {
+            for (uint16_t id = 0; id <= MaxId; id++)
+            {
+                index[id] = NO_COMMAND;
+            }
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (commands[i].id <= MaxId)
+                {
+                    index[commands[i].id] = i;
+                }
+            }
+        }
+
+        /**
+         * @brief Looks up a command by ID.
+         * @param id The command ID.
+         * @return const CommandSpec* The command, nullptr for an unknown ID.
+         */
+        const CommandSpec *find(const uint8_t id) const
+        {
+            return (id <= MaxId && index[id] != NO_COMMAND) ? &commands[index[id]] : nullptr;
+        }
+
+        /**
+         * @brief Checks a downlink without calling any handler.
+         *
+         * @param payload The downlink.
+         * @param size The size of the downlink in bytes.
+         * @return COMMAND_ERRORS COMMAND_OK if the downlink consists of complete, known commands.
+         */
+        COMMAND_ERRORS validate(const uint8_t *payload, const size_t size) const
+        {
+            size_t offset = 0;
+            while (offset < size)
+            {
+                const CommandSpec *spec = find(payload[offset]);
+                if (!spec)
+                {
+                    return COMMAND_ERRORS::COMMAND_UNKNOWN;
+                }
+                offset += getCommandSize(*spec);
+            }
+            return offset == size ? COMMAND_ERRORS::COMMAND_OK : COMMAND_ERRORS::COMMAND_TRUNCATED;
+        }
+
+        /**
+         * @brief Validates a downlink and then calls the handler of every command in order.
+         *
+         * Nothing is executed when any part of the downlink is invalid, so a corrupted downlink
+         * never leaves the device half reconfigured.
+         *
+         * @param payload The downlink.
+         * @param size The size of the downlink in bytes.
+         * @return COMMAND_ERRORS COMMAND_OK if all commands were executed.
+         */
+        COMMAND_ERRORS dispatch(const uint8_t *payload, const size_t size) const
+        {
+            const COMMAND_ERRORS result = validate(payload, size);
+            if (result != COMMAND_ERRORS::COMMAND_OK)
+            {
+                return result;
+            }
+            size_t offset = 0;
+            while (offset < size)
+            {
+                const CommandSpec &spec = *find(payload[offset]);
+                if (spec.handler)
+                {
+                    spec.handler(CommandArguments(spec, payload + offset + 1));
+                }
+                offset += getCommandSize(spec);
+            }
+            return COMMAND_ERRORS::COMMAND_OK;
+        }
+
+    private:
+        static const uint8_t NO_COMMAND = 0xFF;
+        const CommandSpec *commands;
+        uint8_t index[MaxId + 1];
+    }; // End of class CommandDecoder.
+
+    /**
+     * @brief Template class for composing downlinks from the same command table, e.g. on a backend or a test rig.
+     *
+     * @tparam MaxSize Maximum size of the buffer.
+     */
+    template <size_t MaxSize>
+    class CommandEncoder
+    {
+    public:
+        /**
+         * @brief Constructor for CommandEncoder.
+         *
+         * @param size Size of the buffer, normally the max payload of the downlink data rate.
+         */
+        explicit CommandEncoder(const uint8_t size) : operationalSize(size > MaxSize ? MaxSize : size), currentIndex(0) {}
+
+        /**
+         * @brief Resets the buffer.
+         */
+        void reset()
+        {
+            currentIndex = 0;
+        }
+
+        /**
+         * @brief Appends a command with its arguments; values are truncated to the argument types.
+         *
+         * @param spec The command.
+         * @param values The arguments, as many as spec.argumentCount.
+         * @return uint8_t Returns the new size of the downlink, or 0 if the command does not fit or the
+         *                 number of values does not match the command.
+         */
+        template <typename... Values>
+        const uint8_t add(const CommandSpec &spec, const Values... values)
+        {
+            const int32_t list[sizeof...(Values) + 1] = {static_cast<int32_t>(values)...};
+            if (sizeof...(Values) != spec.argumentCount || currentIndex + getCommandSize(spec) > operationalSize)
+            {
+                return 0;
+            }
+            buffer[currentIndex++] = spec.id;
+            for (uint8_t i = 0; i < spec.argumentCount; i++)
+            {
+                for (uint8_t byte = getArgumentSize(spec.arguments[i]); byte > 0; byte--)
+                {
+                    buffer[currentIndex++] = static_cast<uint8_t>(static_cast<uint32_t>(list[i]) >> (8 * (byte - 1)));
+                }
+            }
+            return currentIndex;
+        }
+
+        /**
+         * @brief Gets the size of the downlink.
+         * @return size_t Number of used bytes.
+         */
+        size_t getSize(void) const
+        {
+            return currentIndex;
+        }
+
+        /**
+         * @brief Returns the buffer.
+         * @return const uint8_t* Pointer to the buffer.
+         */
+        const uint8_t *getBuffer(void) const
+        {
+            return buffer;
+        }
+
+    private:
+        uint8_t buffer[MaxSize];
+        size_t operationalSize;
+        size_t currentIndex;
+    }; // End of class CommandEncoder.
+} // End of PAYLOAD_ENCODER Namespace.
+
+#endif // DOWNLINK_COMMANDS_HPP
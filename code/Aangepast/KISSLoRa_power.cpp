@@ -0,0 +1,186 @@
+#include "KISSLoRa_power.h"
+#include "KISSLoRa_sleep.h"
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <Arduino.h>
+
+//all peripherals disabled except timer0 and uart1
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 13.16mA off, 16.58 max
+
+//all peripherals disabled except timer0
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 13.07mA off, 16.48 max
+
+//all peripherals disabled except timer0, disabled on chip debugging
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 13.05mA off, 16.46 max(redone measurement without on chip debugging enabled and got same results, so difference is possbily a measurement error)
+
+//all peripherals disabled except timer1
+//sleep mode: idle
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 10.65mA off, 14.02 on
+
+//all peripherals enabled
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 13.80mA off, 17.22 max
+
+//all peripherals disabled
+//sleep mode: power down
+//supply 3.8V 100mA
+//series current meter
+//rotary switch at 0(0 pins high, so 0*0.33mA)
+//black tape on light sensor
+//3.77 V at connector
+//current consumption: 8.72mA off, 12.04 max
+
+// The currents of the profiles are the "off" values (LEDs off) of the measurements above, for the
+// whole board including the RN2483 and the sensors.
+// USB stays clocked while a cable is connected in every profile, the host would drop the serial port.
+
+#define USB_CONNECTED (USBSTA&(1<<VBUS))
+
+typedef struct {
+  const char *name;
+  uint8_t prr0;       // PRR0 bits, peripherals off
+  uint8_t prr1;       // PRR1 bits, peripherals off
+  bool adc;           // ADC enabled, it must be disabled before PRADC stops its clock
+  bool bodOff;        // BOD off during sleep, only on devices with BODS; the ATmega32U4 sets it by fuse
+  uint16_t current;   // measured board current in uA, 0 if not measured
+} power_profile_t;
+
+static const power_profile_t profiles[KISSLORA_POWER_PROFILES] = {
+  // all peripherals enabled
+  {"active", 0, 0, true, false, 13800},
+  // not measured, left out of the charge estimate
+  {"sensor-read",
+   (1<<PRTIM1) | (1<<PRSPI),
+   (1<<PRUSB) | (1<<PRTIM4) | (1<<PRTIM3),
+   true, false, 0},
+  // idle sleep with a single timer running
+  {"radio-wait",
+   (1<<PRTWI) | (1<<PRTIM1) | (1<<PRSPI) | (1<<PRADC),
+   (1<<PRUSB) | (1<<PRTIM4) | (1<<PRTIM3),
+   false, false, 10650},
+  // power down, UART1 keeps its state for the RN2483
+  {"deep-sleep",
+   (1<<PRTWI) | (1<<PRTIM0) | (1<<PRTIM1) | (1<<PRSPI) | (1<<PRADC),
+   (1<<PRUSB) | (1<<PRTIM4) | (1<<PRTIM3),
+   false, true, 8720},
+};
+
+static KISSLoRa_power_profile_t current = KISSLORA_POWER_ACTIVE;
+static unsigned long since = 0;                               // KISSLoRa_sleep_millis() of the last switch
+static unsigned long timeIn[KISSLORA_POWER_PROFILES] = {0};   // ms spent in every profile
+
+// Internal function: adds the time since the last switch to the current profile
+static void account(void) {
+  unsigned long now = KISSLoRa_sleep_millis();
+  timeIn[current] += now - since;
+  since = now;
+}
+
+//! \brief switches the peripherals to a power profile
+//! Call it with the returned profile to go back, e.g. around a sleep or a measurement.
+//! \param profile new profile
+//! \return the previous profile
+KISSLoRa_power_profile_t KISSLoRa_power_set(KISSLoRa_power_profile_t profile){
+  KISSLoRa_power_profile_t previous = current;
+  if (profile >= KISSLORA_POWER_PROFILES) {
+    return previous;
+  }
+  account();
+
+  const power_profile_t *p = &profiles[profile];
+  uint8_t prr1 = p->prr1;
+  if (USB_CONNECTED) {
+    prr1 &= ~(1<<PRUSB);
+  }
+  if (!p->adc) {
+    ADCSRA &= ~(1<<ADEN);
+  }
+  PRR0 = p->prr0;
+  PRR1 = prr1;
+  if (p->adc) {
+    ADCSRA |= (1<<ADEN);
+  }
+  current = profile;
+  return previous;
+}
+
+//! \brief current power profile
+KISSLoRa_power_profile_t KISSLoRa_power_get(void){
+  return current;
+}
+
+//! \brief name of a power profile for the debug output
+//! \param profile profile
+//! \return e.g. "radio-wait"
+const char *KISSLoRa_power_name(KISSLoRa_power_profile_t profile){
+  return profile < KISSLORA_POWER_PROFILES ? profiles[profile].name : "";
+}
+
+//! \brief measured board current of a power profile
+//! \param profile profile
+//! \return current in uA, 0 for an unknown or not measured profile
+uint16_t KISSLoRa_power_current_ua(KISSLoRa_power_profile_t profile){
+  return profile < KISSLORA_POWER_PROFILES ? profiles[profile].current : 0;
+}
+
+//! \brief time spent in a power profile since start, including the running stretch
+//! \param profile profile
+//! \return ms, wraps like millis()
+unsigned long KISSLoRa_power_time_ms(KISSLoRa_power_profile_t profile){
+  if (profile >= KISSLORA_POWER_PROFILES) {
+    return 0;
+  }
+  account();
+  return timeIn[profile];
+}
+
+//! \brief estimated charge used since start, from the time in every profile and the measured currents
+//! Profiles without a measured current are left out, the estimate is low by their share.
+//! \return charge in mAh
+float KISSLoRa_power_charge_mah(void){
+  account();
+  float mas = 0;
+  for (uint8_t i = 0; i < KISSLORA_POWER_PROFILES; i++) {
+    mas += timeIn[i] / 1000.0 * profiles[i].current / 1000.0;
+  }
+  return mas / 3600.0;
+}
+
+//! \brief enters the selected sleep mode, turns the BOD off first when the profile asks for it
+//! The sleep mode must be set and enabled by the caller. Call it with interrupts disabled, after checking the
+//! wake-up condition: interrupts are enabled in the instruction before the sleep, so an interrupt that
+//! arrives after the check still wakes the microcontroller. Returns with interrupts enabled.
+void KISSLoRa_power_sleep_cpu(void){
+#if defined(BODS)
+  if (profiles[current].bodOff) {
+    sleep_bod_disable();  // timed sequence, must be done right before sleep
+  }
+#endif
+  sei();
+  sleep_cpu();  // executed before any pending interrupt, sei takes effect after the next instruction
+}
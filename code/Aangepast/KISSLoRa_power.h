@@ -0,0 +1,34 @@
+/*
+File name: KISSLoRa_power.h
+Purpose  : peripheral power profiles for KISSLoRa, with the measured current of every profile
+*/
+
+#ifndef KISSLoRa_power_h
+#define KISSLoRa_power_h 1
+
+#include <stdint.h>
+
+//! Power profiles, every profile sets the whole power reduction register state.
+typedef enum {
+  KISSLORA_POWER_ACTIVE = 0,    ///< All peripherals on
+  KISSLORA_POWER_SENSOR_READ,   ///< TWI, ADC, UART1 and timer0 for the sensors and the RN2483
+  KISSLORA_POWER_RADIO_WAIT,    ///< UART1 and timer0 only, idle sleep while the RN2483 is busy
+  KISSLORA_POWER_DEEP_SLEEP,    ///< Everything off except UART1, power down between deadlines
+  KISSLORA_POWER_PROFILES       ///< Number of profiles
+} KISSLoRa_power_profile_t;
+
+KISSLoRa_power_profile_t KISSLoRa_power_set(KISSLoRa_power_profile_t profile);
+
+KISSLoRa_power_profile_t KISSLoRa_power_get(void);
+
+const char *KISSLoRa_power_name(KISSLoRa_power_profile_t profile);
+
+uint16_t KISSLoRa_power_current_ua(KISSLoRa_power_profile_t profile);
+
+unsigned long KISSLoRa_power_time_ms(KISSLoRa_power_profile_t profile);
+
+float KISSLoRa_power_charge_mah(void);
+
+void KISSLoRa_power_sleep_cpu(void);
+
+#endif
@@ -0,0 +1,211 @@
+#include "KISSLoRa_scheduler.h"
+#include "KISSLoRa_sleep.h"
+#include "KISSLoRa_power.h"
+
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include <Arduino.h>
+
+// Tasks are kept in a small fixed table, there is no heap on this board.
+// Every task has a deadline and a slack: it may run up to slack ms before its deadline.
+// The scheduler only wakes up for deadlines; at every wake-up it also runs the tasks whose
+// slack window is open, so tasks with a large slack piggyback on the wake-ups of other tasks
+// instead of forcing their own.
+
+typedef struct {
+  KISSLoRa_task_t task;     // task function, NULL for a free entry
+  unsigned long period;     // ms between deadlines, 0 for a task that only runs when triggered
+  unsigned long slack;      // ms the task may run before its deadline
+  unsigned long deadline;   // KISSLoRa_sleep_millis() time of the next run
+  bool scheduled;           // deadline is valid
+} task_entry_t;
+
+static task_entry_t tasks[KISSLORA_SCHEDULER_MAX_TASKS];
+static uint8_t taskCount = 0;
+static volatile uint8_t pendingMask = 0;  // triggered tasks, bit per task, set from ISRs
+static KISSLoRa_scheduler_stats_t stats = {0, 0, 0, 0, 0};
+
+// Internal function: true if time a is before time b, correct over a millis() wrap
+static bool isBefore(unsigned long a, unsigned long b) {
+  return (long)(a - b) < 0;
+}
+
+// Internal function: runs a task and moves its deadline one period ahead
+static void runTask(uint8_t id) {
+  tasks[id].task();
+  stats.runs++;
+
+  if (tasks[id].period == 0) {
+    tasks[id].scheduled = false;
+    return;
+  }
+  tasks[id].deadline += tasks[id].period;
+  unsigned long now = KISSLoRa_sleep_millis();
+  if (!isBefore(now, tasks[id].deadline)) {
+    // more than a period behind, e.g. after a long send; skip the missed runs
+    tasks[id].deadline = now + tasks[id].period;
+  }
+}
+
+// Internal function: ms until the earliest deadline, 0 if a task is due or triggered
+static unsigned long timeToNextDeadline(void) {
+  if (pendingMask != 0) {
+    return 0;
+  }
+  unsigned long now = KISSLoRa_sleep_millis();
+  unsigned long wait = 0x7FFFFFFFUL;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (tasks[i].scheduled) {
+      if (!isBefore(now, tasks[i].deadline)) {
+        return 0;
+      }
+      if (tasks[i].deadline - now < wait) {
+        wait = tasks[i].deadline - now;
+      }
+    }
+  }
+  return wait;
+}
+
+//! \brief adds a task to the scheduler
+//! \param task function to run
+//! \param period_ms ms between runs, 0 for a task that only runs when triggered
+//! \param slack_ms ms the task may run early to share a wake-up with another task, 0 for exact timing
+//! \param first_ms ms from now to the first run, ignored when period_ms is 0
+//! \return task id, KISSLORA_SCHEDULER_NO_TASK if the task table is full
+uint8_t KISSLoRa_scheduler_add(KISSLoRa_task_t task, unsigned long period_ms, unsigned long slack_ms, unsigned long first_ms){
+  if (taskCount >= KISSLORA_SCHEDULER_MAX_TASKS) {
+    return KISSLORA_SCHEDULER_NO_TASK;
+  }
+  task_entry_t *entry = &tasks[taskCount];
+  entry->task = task;
+  entry->period = period_ms;
+  entry->slack = slack_ms;
+  entry->deadline = KISSLoRa_sleep_millis() + first_ms;
+  entry->scheduled = period_ms != 0;
+  return taskCount++;
+}
+
+//! \brief changes the period of a task, the new period applies from the next run
+//! \param id task id
+//! \param period_ms ms between runs, 0 to only run when triggered
+void KISSLoRa_scheduler_set_period(uint8_t id, unsigned long period_ms){
+  if (id >= taskCount) {
+    return;
+  }
+  if (!tasks[id].scheduled && period_ms != 0) {
+    tasks[id].deadline = KISSLoRa_sleep_millis() + period_ms;
+    tasks[id].scheduled = true;
+  }
+  tasks[id].period = period_ms;
+}
+
+//! \brief runs a task as soon as possible, ends the current sleep
+//! Can be called from an ISR.
+//! \param id task id
+void KISSLoRa_scheduler_trigger(uint8_t id){
+  if (id >= KISSLORA_SCHEDULER_MAX_TASKS) {
+    return;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    pendingMask |= (1 << id);
+  }
+  KISSLoRa_sleep_abort();
+}
+
+//! \brief ms until the deadline of a task, e.g. to let the radio sleep until the next uplink
+//! \param id task id
+//! \return ms until the next run, 0 if the task is due or not scheduled
+unsigned long KISSLoRa_scheduler_time_to(uint8_t id){
+  if (id >= taskCount || !tasks[id].scheduled) {
+    return 0;
+  }
+  unsigned long now = KISSLoRa_sleep_millis();
+  return isBefore(now, tasks[id].deadline) ? tasks[id].deadline - now : 0;
+}
+
+//! \brief runs the triggered tasks, then all due tasks and the tasks whose slack window is open, in deadline order
+//! \return ms until the next deadline
+unsigned long KISSLoRa_scheduler_run(void){
+  uint8_t pending;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    pending = pendingMask;
+    pendingMask = 0;
+  }
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (pending & (1 << i)) {
+      runTask(i);
+    }
+  }
+
+  for (;;) {
+    unsigned long now = KISSLoRa_sleep_millis();
+    uint8_t next = KISSLORA_SCHEDULER_NO_TASK;
+    for (uint8_t i = 0; i < taskCount; i++) {
+      if (tasks[i].scheduled && !isBefore(now + tasks[i].slack, tasks[i].deadline)
+          && (next == KISSLORA_SCHEDULER_NO_TASK || isBefore(tasks[i].deadline, tasks[next].deadline))) {
+        next = i;
+      }
+    }
+    if (next == KISSLORA_SCHEDULER_NO_TASK) {
+      break;
+    }
+    if (isBefore(now, tasks[next].deadline)) {
+      stats.coalesced++;
+    } else if (now - tasks[next].deadline > stats.maxLateness) {
+      stats.maxLateness = now - tasks[next].deadline;
+    }
+    runTask(next);
+  }
+  return timeToNextDeadline();
+}
+
+// Internal function: idle sleeps in the radio-wait profile until target or a trigger
+// Timer0 keeps running, so KISSLoRa_sleep_millis() stays valid; its tick ends every sleep briefly.
+static void idleUntil(unsigned long target) {
+  KISSLoRa_power_profile_t previous = KISSLoRa_power_set(KISSLORA_POWER_RADIO_WAIT);
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  cli();  // a trigger between the check and the sleep would not wake the cpu
+  while (pendingMask == 0 && isBefore(KISSLoRa_sleep_millis(), target)) {
+    KISSLoRa_power_sleep_cpu();
+    cli();
+  }
+  sei();
+  sleep_disable();
+
+  KISSLoRa_power_set(previous);
+}
+
+//! \brief waits until the next deadline or a trigger
+//! Sleeps in power down for whole 16 ms WDT periods, waking a margin before the deadline: the expected
+//! WDT error of the sleep (KISSLoRa_sleep_error_ms()) plus the fixed start-up time. The rest is spent in
+//! idle sleep.
+//! \param power_down false to wait awake, e.g. while USB is connected
+void KISSLoRa_scheduler_sleep(bool power_down){
+  unsigned long wait = timeToNextDeadline();
+  unsigned long target = KISSLoRa_sleep_millis() + wait;
+
+  if (!power_down) {
+    while (pendingMask == 0 && isBefore(KISSLoRa_sleep_millis(), target)) {
+      delay(1);
+    }
+    return;
+  }
+
+  unsigned long margin = KISSLoRa_sleep_error_ms(wait) + KISSLORA_SCHEDULER_WAKE_LATENCY;
+  if (wait >= KISSLORA_SCHEDULER_MIN_SLEEP + margin) {
+    KISSLoRa_sleep_delay_ms((wait - margin) & ~15UL);
+    stats.wakeups++;
+    stats.wakeMargin = margin;
+  }
+
+  idleUntil(target);
+}
+
+//! \brief copies the scheduler counters
+//! \param out destination
+void KISSLoRa_scheduler_get_stats(KISSLoRa_scheduler_stats_t *out){
+  *out = stats;
+}
@@ -0,0 +1,42 @@
+/*
+File name: KISSLoRa_scheduler.h
+Purpose  : tickless cooperative task scheduler for KISSLoRa, sleeps in power down between deadlines
+*/
+
+#ifndef KISSLoRa_scheduler_h
+#define KISSLoRa_scheduler_h 1
+
+#include <stdint.h>
+
+#define KISSLORA_SCHEDULER_MAX_TASKS      6     ///< Size of the task table
+#define KISSLORA_SCHEDULER_NO_TASK        0xFF  ///< Returned by KISSLoRa_scheduler_add() when the table is full
+#define KISSLORA_SCHEDULER_WAKE_LATENCY   4     ///< ms for oscillator start-up and wake-up bookkeeping, added to the WDT error
+#define KISSLORA_SCHEDULER_MIN_SLEEP      32    ///< Shorter waits are done in idle sleep, power down does not pay off
+
+//! Task function, runs to completion.
+typedef void (*KISSLoRa_task_t)(void);
+
+//! Counters for the debug output.
+typedef struct {
+  unsigned long wakeups;      ///< Number of power down sleeps
+  unsigned long runs;         ///< Number of task runs
+  unsigned long coalesced;    ///< Runs that were moved forward to share a wake-up with another task
+  unsigned long maxLateness;  ///< Largest delay in ms of a task after its deadline
+  unsigned long wakeMargin;   ///< Early-wake margin in ms of the last power down sleep
+} KISSLoRa_scheduler_stats_t;
+
+uint8_t KISSLoRa_scheduler_add(KISSLoRa_task_t task, unsigned long period_ms, unsigned long slack_ms, unsigned long first_ms);
+
+void KISSLoRa_scheduler_set_period(uint8_t id, unsigned long period_ms);
+
+void KISSLoRa_scheduler_trigger(uint8_t id);
+
+unsigned long KISSLoRa_scheduler_time_to(uint8_t id);
+
+unsigned long KISSLoRa_scheduler_run(void);
+
+void KISSLoRa_scheduler_sleep(bool power_down);
+
+void KISSLoRa_scheduler_get_stats(KISSLoRa_scheduler_stats_t *stats);
+
+#endif
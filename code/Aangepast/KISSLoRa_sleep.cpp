@@ -1,4 +1,5 @@
 #include "KISSLoRa_sleep.h"
+#include "KISSLoRa_power.h"
 
 //http://playground.arduino.cc/Learning/ArduinoSleepCode
 //http://playground.arduino.cc/Code/Timer1
@@ -11,57 +12,10 @@
 #include <avr/sleep.h>
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <Arduino.h>
 
-//all peripherals disabled except timer0 and uart1
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 13.16mA off, 16.58 max
-
-//all peripherals disabled except timer0
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 13.07mA off, 16.48 max
-
-//all peripherals disabled except timer0, disabled on chip debugging
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 13.05mA off, 16.46 max(redone measurement without on chip debugging enabled and got same results, so difference is possbily a measurement error)
-
-//all peripherals disabled except timer1
-//sleep mode: idle
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 10.65mA off, 14.02 on
-
-//all peripherals enabled
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 13.80mA off, 17.22 max
-
-//all peripherals disabled
-//sleep mode: power down
-//supply 3.8V 100mA
-//series current meter
-//rotary switch at 0(0 pins high, so 0*0.33mA)
-//black tape on light sensor
-//3.77 V at connector
-//current consumption: 8.72mA off, 12.04 max
+// The measured currents of the peripheral combinations are in KISSLoRa_power.cpp
 
 /*
 static volatile uint8_t pin_interrupt_flag;
@@ -78,6 +32,26 @@ static void KISSLoRa_led_toggle(void){
 static long timeSleep = 0;  // total time due to sleep
 static float calibv = 0.93; // ratio of real clock with WDT clock
 static volatile uint8_t isrcalled = 0;  // WDT vector flag
+static volatile uint8_t abortcalled = 0;  // sleep abort request, set from an ISR
+static volatile uint8_t sleeping = 0;  // in a power down sleep, millis() stopped
+static volatile long sleepDone = 0;    // WDT ms of the finished periods of the current sleep
+static volatile uint8_t sleepPs = 0;   // WDT prescaler of the current period
+
+// UART wake-up: RXD1 (Arduino pin 0, PD2) is also INT2, which detects edges without a clock and so
+// wakes the MCU from power down when the RN2483 starts writing
+#define RX_WAKE_PIN 0
+static void (*rxHandler)(void) = NULL;  // called when RN2483 output ended a power down sleep
+
+// Drift tracking: while awake the WDT runs free in interrupt mode and every period is timed
+// with micros(), timer0 runs from the crystal. The periods are folded into calibv before the next sleep.
+#define TRACK_PRESCALER 1             // WDT prescaler while tracking, 32 ms
+#define TRACK_WEIGHT    16.0          // a fold of n periods moves calibv by n/(n+TRACK_WEIGHT)
+#define TRACK_OUTLIER   0.2           // periods that differ more than 20% from calibv are ignored
+static float calibdev = 0.05;         // filtered deviation of calibv, start with the datasheet spread
+static volatile uint8_t tracking = 0; // WDT is timing periods for drift tracking
+static volatile unsigned long trackStamp = 0;   // micros() at the last WDT interrupt
+static volatile unsigned long trackMicros = 0;  // sum of the measured periods
+static volatile uint16_t trackCount = 0;        // number of measured periods
 
 // Internal function: Start watchdog timer
 // byte psVal - Prescale mask
@@ -111,28 +85,38 @@ static void WDT_Off() {
 }
 
 // internal function.  
-static int doSleep(long timeRem) {
+static long doSleep(long timeRem) {
  uint8_t WDTps = 9;  // WDT Prescaler value, 9 = 8192ms
 
+ tracking = 0;
  isrcalled = 0;
  sleep_enable();
- while(timeRem > 0) {
+ while(timeRem > 0 && abortcalled == 0) {
    //work out next prescale unit to use
    while ((0x10<<WDTps) > timeRem && WDTps > 0) {
      WDTps--;
    }
    // send prescaler mask to WDT_On
+   sleepPs = WDTps;
    WDT_On((WDTps & 0x08 ? (1<<WDP3) : 0x00) | (WDTps & 0x07));
    isrcalled=0;
-   while (isrcalled==0) {
-     // turn bod off
-      // MCUCR |= (1<<BODS) | (1<<BODSE);
-     //MCUCR &= ~(1<<BODSE);  // must be done right before sleep
-     sleep_cpu();  // sleep here
+   cli();  // an interrupt between the check and the sleep would not wake the cpu
+   while (isrcalled==0 && abortcalled==0) {
+     KISSLoRa_power_sleep_cpu();  // sleep here with interrupts enabled, turns bod off if the profile asks for it
+     cli();
+   }
+   sei();
+   if (isrcalled==0) {
+     // woken by another interrupt, the WDT period was on average half over
+     WDT_Off();
+     timeRem -= (0x10<<WDTps)/2;
+   } else {
+     // calculate remaining time
+     timeRem -= (0x10<<WDTps);
+     sleepDone += (0x10<<WDTps);
    }
-   // calculate remaining time
-   timeRem -= (0x10<<WDTps);
  }
+ abortcalled = 0;
  sleep_disable();
  return timeRem;
 }
@@ -147,8 +131,47 @@ static void calibrate() {
  calibv = 256.0/(tt2-tt1);
 }
 
+// Internal function: start timing WDT periods against micros(), only while timer0 runs
+static void startTracking() {
+ trackMicros = 0;
+ trackCount = 0;
+ tracking = 1;
+ WDT_On(TRACK_PRESCALER);
+ trackStamp = micros();
+}
+
+// Internal function: stop tracking and filter the measured periods into calibv
+static void foldTracking() {
+ cli();
+ uint8_t wasTracking = tracking;
+ tracking = 0;
+ uint16_t count = trackCount;
+ unsigned long us = trackMicros;
+ sei();
+ if (!wasTracking) {
+   return;
+ }
+ WDT_Off();
+ if (count == 0) {
+   return;
+ }
+ float sample = (count * (float)(0x10<<TRACK_PRESCALER) * 1000.0) / us;  // WDT ms per real ms
+ float error = sample - calibv;
+ if (fabs(error) > TRACK_OUTLIER * calibv) {
+   return;  // e.g. interrupts were disabled for a long time
+ }
+ float weight = count / (count + TRACK_WEIGHT);
+ calibv += error * weight;
+ calibdev += (fabs(error) - calibdev) * weight;
+}
+
 // Estimated millis is real clock + calibrated sleep time
-static long estMillis() {
+static unsigned long estMillis() {
+ if (sleeping) {
+   // called from the ISR that ends a power down sleep: count the finished WDT periods and half
+   // of the current one, as doSleep() does, so the time equals the clock after the wake-up
+   return millis()+timeSleep+(long)((sleepDone+(0x10<<sleepPs)/2)/calibv);
+ }
  return millis()+timeSleep;
 }
 
@@ -156,21 +179,38 @@ static long estMillis() {
 
 // Delay function
 static void sleepCPU_delay(long sleepTime) {
- //ADCSRA &= ~(1<<ADEN);  // adc off
- //PRR = 0xEF; // modules off
-
  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
- int trem = doSleep(sleepTime*calibv);
- timeSleep += (sleepTime-trem);
-
- //PRR = 0x00; //modules on
- //ADCSRA |= (1<<ADEN);  // adc on
+ sleepDone = 0;
+ sleeping = 1;
+ long trem = doSleep(sleepTime*calibv);
+ // trem is in WDT time, convert back to real time
+ ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+   timeSleep += (sleepTime-(long)(trem/calibv));
+   sleeping = 0;
+ }
 }
 
 
 
+// RX pin interrupt: the RN2483 started writing, end the sleep
+static void rxWakeISR(void) {
+ detachInterrupt(digitalPinToInterrupt(RX_WAKE_PIN));
+ abortcalled = 1;
+ if (rxHandler) {
+   rxHandler();
+ }
+}
+
 // wdt int service routine
 ISR(WDT_vect) {
+ if (tracking) {
+   // interrupt mode keeps the WDT running, time the next period from here
+   unsigned long now = micros();
+   trackMicros += now - trackStamp;
+   trackStamp = now;
+   trackCount++;
+   return;
+ }
  WDT_Off();
  isrcalled=1;
 }
@@ -248,6 +288,7 @@ void KISSLoRa_sleep_init(void){
   set_sleep_mode(SLEEP_MODE_PWR_DOWN);
   sleep_enable();
   calibrate();
+  startTracking();
   
 /*
   power_usb_disable();  
@@ -265,31 +306,81 @@ void KISSLoRa_sleep_init(void){
 }
 
 //! \brief powers down peripherals and puts microcontroller in power down sleep mode, wakes up on watchdog timer
+//! Switches to the deep-sleep power profile and back to the previous profile after the sleep.
 void KISSLoRa_sleep_delay_ms(long delay_ms){
-  power_usb_disable();  
-  power_timer0_disable();
-  power_timer1_disable();
-  power_timer2_disable();
-  power_timer3_disable();
-  //output compare modulator?
-  power_adc_disable();
-  power_usart0_disable();
-  //power_usart1_disable();//lora
-  power_spi_disable();
-  power_twi_disable();
+  foldTracking();
+
+  KISSLoRa_power_profile_t previous = KISSLoRa_power_set(KISSLORA_POWER_DEEP_SLEEP);
+
+  if (rxHandler) {
+    EIFR = (1<<INTF2);  // forget edges of earlier modem output
+    attachInterrupt(digitalPinToInterrupt(RX_WAKE_PIN), rxWakeISR, FALLING);
+  }
   
   sleepCPU_delay(delay_ms);
 
-  power_usb_enable();  
-  power_timer0_enable();
-  power_timer1_enable();
-  power_timer2_enable();
-  power_timer3_enable();
-  //output compare modulator?
-  power_adc_enable();
-  power_usart0_enable();
-  //power_usart1_enable();//lora
-  power_spi_enable();
-  power_twi_enable();
+  if (rxHandler) {
+    detachInterrupt(digitalPinToInterrupt(RX_WAKE_PIN));
+  }
+
+  KISSLoRa_power_set(previous);
+
+  startTracking();
+}
+
+//! \brief ends the current or next KISSLoRa_sleep_delay_ms() early
+//! Can be called from an ISR, e.g. a button or pin change interrupt that woke the microcontroller.
+//! The interrupted WDT period is counted as half elapsed.
+void KISSLoRa_sleep_abort(void){
+  abortcalled = 1;
+}
+
+//! \brief milliseconds since start including the time spent in power down sleep, where millis() stops
+//! Can be called from an ISR, e.g. to time an event; an interrupt that ends a power down sleep gets the
+//! time the clock continues from after the wake-up.
+//! \return estimated milliseconds, wraps like millis()
+unsigned long KISSLoRa_sleep_millis(void){
+  return estMillis();
+}
+
+//! \brief expected error of a power down sleep, from the filtered deviation of the WDT clock
+//! The WDT is timed against the crystal clock whenever the microcontroller is awake, so the bound
+//! follows temperature and supply changes; use it as guard time instead of a fixed margin.
+//! \param sleep_ms planned sleep in ms
+//! \return error bound in ms (3 times the deviation), the sleep ends within +/- this bound
+unsigned long KISSLoRa_sleep_error_ms(unsigned long sleep_ms){
+  return (unsigned long)(sleep_ms * (3 * calibdev / calibv)) + 1;
+}
+
+//! \brief lets RN2483 output end a power down sleep, through INT2 on the UART1 RX pin
+//! The oscillator needs about 2 ms to start, so the first characters of the line that woke the
+//! microcontroller are lost; the rest is received by Serial1 as usual. Use it for modem output that
+//! may come unannounced, e.g. the "ok" at the end of a modem sleep, and KISSLoRa_sleep_until_rx()
+//! when the output is expected.
+//! \param handler called from the ISR after the wake-up, e.g. to trigger a scheduler task; NULL disables
+void KISSLoRa_sleep_wake_on_rx(void (*handler)(void)){
+  rxHandler = handler;
 }
 
+//! \brief sleeps in idle mode until the RN2483 writes on UART1, max_ms passed or KISSLoRa_sleep_abort() is called
+//! UART1 and timer0 keep running, so no character is lost and millis() stays valid. The receive
+//! interrupt wakes the microcontroller, the timer0 tick only briefly. Use it to wait for an expected
+//! modem answer, e.g. the result of an uplink, instead of polling. Runs in the radio-wait power profile.
+//! \param max_ms longest sleep in ms
+void KISSLoRa_sleep_until_rx(long max_ms){
+  KISSLoRa_power_profile_t previous = KISSLoRa_power_set(KISSLORA_POWER_RADIO_WAIT);
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  unsigned long start = millis();
+  cli();  // an interrupt between the check and the sleep would not wake the cpu
+  while (!Serial1.available() && abortcalled == 0 && (long)(millis() - start) < max_ms) {
+    KISSLoRa_power_sleep_cpu();  // woken by the receive interrupt or the timer0 tick
+    cli();
+  }
+  sei();
+  abortcalled = 0;
+  sleep_disable();
+
+  KISSLoRa_power_set(previous);
+}
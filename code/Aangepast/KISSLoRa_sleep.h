@@ -15,4 +15,14 @@ void KISSLoRa_sleep_init(void);
 
 void KISSLoRa_sleep_delay_ms(long delay_ms);
 
+void KISSLoRa_sleep_abort(void);
+
+unsigned long KISSLoRa_sleep_millis(void);
+
+unsigned long KISSLoRa_sleep_error_ms(unsigned long sleep_ms);
+
+void KISSLoRa_sleep_wake_on_rx(void (*handler)(void));
+
+void KISSLoRa_sleep_until_rx(long max_ms);
+
 #endif
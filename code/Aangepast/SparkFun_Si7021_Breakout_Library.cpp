@@ -38,8 +38,12 @@
 #endif
 
 
+ // Max. conversion times in us from the datasheet, by resolution setting (see changeResolution())
+ static const uint16_t rhConversion[4]   = {12000, 3100, 4500, 7000};
+ static const uint16_t tempConversion[4] = {10800, 3800, 6200, 2400};
+
  //Initialize
- Weather::Weather(){}
+ Weather::Weather() : resolution(0), measureCommand(TEMP_PREV), measureStart(0), sleepFunction(NULL) {}
 
  bool Weather::begin(void)
 {
@@ -47,6 +51,10 @@
 
   uint8_t ID_Temp_Hum = checkID();
 
+  // Resolution bits RES1 (bit 7) and RES0 (bit 0) of the user register
+  uint8_t regVal = readReg();
+  resolution = ((regVal >> 6) & 0x02) | (regVal & 0x01);
+
   int x = 0;
 
   if(ID_Temp_Hum == 0x15)//Ping CheckID register
@@ -77,25 +85,22 @@
 float Weather::getRH()
 {
 	// Measure the relative humidity
-	uint16_t RH_Code = makeMeasurment(HUMD_MEASURE_NOHOLD);
-	float result = (125.0*RH_Code/65536)-6;
-	return result;
+	startMeasurement(HUMD_MEASURE_NOHOLD);
+	return readResult();
 }
 
 float Weather::readTemp()
 {
 	// Read temperature from previous RH measurement.
-	uint16_t temp_Code = makeMeasurment(TEMP_PREV);
-	float result = (175.25*temp_Code/65536)-46.85;
-	return result;
+	startMeasurement(TEMP_PREV);
+	return readResult();
 }
 
 float Weather::getTemp()
 {
 	// Measure temperature
-	uint16_t temp_Code = makeMeasurment(TEMP_MEASURE_NOHOLD);
-	float result = (175.25*temp_Code/65536)-46.85;
-	return result;
+	startMeasurement(TEMP_MEASURE_NOHOLD);
+	return readResult();
 }
 //Give me temperature in fahrenheit!
 float Weather::readTempF()
@@ -138,7 +143,7 @@ void Weather::changeResolution(uint8_t i)
 
 	uint8_t regVal = readReg();
 	// zero resolution bits
-	regVal &= 0b011111110;
+	regVal &= 0b01111110;
 	switch (i) {
 	  case 1:
 	    regVal |= 0b00000001;
@@ -148,18 +153,21 @@ void Weather::changeResolution(uint8_t i)
 	    break;
 	  case 3:
 	    regVal |= 0b10000001;
+	    break;
 	  default:
-	    regVal |= 0b00000000;
+	    i = 0;
 	    break;
 	}
 	// write new resolution settings to the register
 	writeReg(regVal);
+	resolution = i;
 }
 
 void Weather::reset()
 {
 	//Reset user resister
 	writeReg(SOFT_RESET);
+	resolution = 0;
 }
 
 uint8_t Weather::checkID()
@@ -179,31 +187,89 @@ uint8_t Weather::checkID()
     return(ID_1);
 }
 
-uint16_t Weather::makeMeasurment(uint8_t command)
+void Weather::startMeasurement(uint8_t command)
 {
-	// Take one ADDRESS measurement given by command.
-	// It can be either temperature or relative humidity
+	// Start one ADDRESS measurement given by command and return at once.
+	// Use a *_NOHOLD command, the bus stays free during the conversion.
+	Wire.beginTransmission(ADDRESS);
+	Wire.write(command);
+	Wire.endTransmission();
+	measureCommand = command;
+	measureStart = micros();
+}
+
+bool Weather::isReady()
+{
+	// True once the max. conversion time of the started measurement passed
+	return micros() - measureStart >= conversionTime(measureCommand);
+}
+
+float Weather::readResult()
+{
+	// Read the measurement started by startMeasurement(), waits until it is ready.
+	// With a sleep function the MCU sleeps for the rest of the conversion.
+	unsigned long elapsed = micros() - measureStart;
+	unsigned long conversion = conversionTime(measureCommand);
+	if (elapsed < conversion)
+	{
+		if (sleepFunction)
+		{
+			// micros() may stop during the sleep, the read polls the sensor instead
+			sleepFunction((conversion - elapsed + 999) / 1000);
+		}
+		else
+		{
+			while (!isReady());
+		}
+	}
+	uint16_t code = readMeasurment(measureCommand);
+	if (measureCommand == HUMD_MEASURE_NOHOLD || measureCommand == HUMD_MEASURE_HOLD)
+	{
+		return (125.0*code/65536)-6;
+	}
+	return (175.25*code/65536)-46.85;
+}
+
+void Weather::setSleep(void (*sleep)(unsigned long ms))
+{
+	// Set the function that lets the MCU sleep during a conversion in
+	// readResult(), getRH() and getTemp(); if it returns early, the read polls
+	// the sensor until the result is there.
+	// NULL waits awake.
+	sleepFunction = sleep;
+}
+
+unsigned long Weather::conversionTime(uint8_t command)
+{
+	// Max. conversion time in us of command at the current resolution.
+	// An RH measurement includes a temperature measurement.
+	switch (command) {
+	  case HUMD_MEASURE_HOLD:
+	  case HUMD_MEASURE_NOHOLD:
+	    return (unsigned long)rhConversion[resolution] + tempConversion[resolution];
+	  case TEMP_MEASURE_HOLD:
+	  case TEMP_MEASURE_NOHOLD:
+	    return tempConversion[resolution];
+	  default:
+	    return 0;
+	}
+}
+
+uint16_t Weather::readMeasurment(uint8_t command)
+{
+	// Read the result of a measurement given by command.
 	// TODO: implement checksum checking
 
 	uint16_t nBytes = 3;
 	// if we are only reading old temperature, read olny msb and lsb
-	if (command == 0xE0) nBytes = 2;
-
-	Wire.beginTransmission(ADDRESS);
-	Wire.write(command);
-	Wire.endTransmission();
-	// When not using clock stretching (*_NOHOLD commands) delay here
-	// is needed to wait for the measurement.
-	// According to datasheet the max. conversion time is ~22ms
-	 delay(100);
+	if (command == TEMP_PREV) nBytes = 2;
 
-	Wire.requestFrom(ADDRESS,nBytes);
-	//Wait for data
+	// The sensor does not acknowledge the read until the conversion is done
 	int counter = 0;
-	while (Wire.available() < nBytes){
+	while (Wire.requestFrom(ADDRESS,nBytes) < nBytes){
 	  delay(1);
 	  counter ++;
-	  if (counter >100){
+	  if (counter > READ_TIMEOUT){
 	    // Timeout: Sensor did not return any data
 	    return 100;
 	  }
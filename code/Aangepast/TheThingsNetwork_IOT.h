@@ -66,6 +66,60 @@
  */
 #define TTN_DEFAULT_TIMEOUT 10000
 
+/**
+ * @def TTN_RX_WINDOWS_TIME
+ * Time in milliseconds from the end of an uplink to the end of its second receive window (RX2 delay plus window).
+ */
+#define TTN_RX_WINDOWS_TIME 3000
+
+/**
+ * @def TTN_DR_REFRESH_UPLINKS
+ * Number of uplinks after which getMaxPayload() queries the data rate again when ADR is enabled.
+ */
+#define TTN_DR_REFRESH_UPLINKS 8
+
+/**
+ * @def TTN_FRAGMENT_PORT
+ * Default port for the fragments of payloads that do not fit in one uplink.
+ */
+#define TTN_FRAGMENT_PORT 200
+
+/**
+ * @def TTN_FRAGMENT_HEADER_SIZE
+ * Size of the header in front of every fragment: message ID and fragment index/last index.
+ */
+#define TTN_FRAGMENT_HEADER_SIZE 2
+
+/**
+ * @def TTN_FRAGMENT_MAX_COUNT
+ * Maximum number of fragments per message (the index is a nibble).
+ */
+#define TTN_FRAGMENT_MAX_COUNT 16
+
+/**
+ * @def TTN_URGENT_RETRIES
+ * Default number of retransmissions of a confirmed sendUrgent().
+ */
+#define TTN_URGENT_RETRIES 3
+
+/**
+ * @def TTN_SLEEP_CONFIRM_TIMEOUT
+ * Time in milliseconds in which the modem rejects a sleep command; no answer means it sleeps.
+ */
+#define TTN_SLEEP_CONFIRM_TIMEOUT 20
+
+/**
+ * @def TTN_SLEEP_GUARD_DIVISOR
+ * Without a guard time, sleepAll() lets the modem sleep 1/TTN_SLEEP_GUARD_DIVISOR longer than the MCU, so the modem never wakes first.
+ */
+#define TTN_SLEEP_GUARD_DIVISOR 8
+
+/**
+ * @def TTN_FAST_WAKE_TIMEOUT
+ * Time in milliseconds the fast wake path waits for the modem before falling back to the full auto-baud.
+ */
+#define TTN_FAST_WAKE_TIMEOUT 50
+
 /**
  * @typedef port_t
  * Type definition for port number.
@@ -78,7 +132,10 @@ typedef uint8_t port_t;
  */
 enum ttn_response_t
 {
+  TTN_PENDING = 0, ///< process() has no complete result yet.
   TTN_ERROR_SEND_COMMAND_FAILED = (-1),
+  TTN_ERROR_DEFERRED = (-2), ///< The modem refused the uplink for now (no free channel or busy), send it again later.
+  TTN_ERROR_PAYLOAD_TOO_LARGE = (-4),
   TTN_ERROR_UNEXPECTED_RESPONSE = (-10),
   TTN_SUCCESSFUL_TRANSMISSION = 1,
   TTN_SUCCESSFUL_RECEIVE = 2,
@@ -180,6 +237,30 @@ private:
   bool baudDetermined = false; ///< Flag indicating whether baud rate is determined.
   void (*messageCallback)(const uint8_t *payload, size_t size, port_t port); ///< Callback function for message reception.
   lorawan_class_t lw_class = CLASS_A; ///< LoRaWAN device class.
+  port_t fragmentPort = 0; ///< Port for fragments, 0 when fragmentation is disabled.
+  uint8_t fragmentId = 0; ///< Message ID of the last fragmented message.
+  const uint8_t *fragmentPayload = NULL; ///< Payload of the fragmented message being sent, NULL when there is none.
+  size_t fragmentLength = 0; ///< Length of the fragmented message.
+  size_t fragmentOffset = 0; ///< Bytes of [port][payload...] sent so far.
+  uint8_t fragmentIndex = 0; ///< Index of the next fragment.
+  port_t fragmentMessagePort = 0; ///< Original port of the fragmented message.
+  bool fragmentConfirm = false; ///< Send the fragments confirmed.
+  int8_t dr = -1; ///< Cached data rate, -1 when unknown.
+  uint8_t drAge = 0; ///< Uplinks since the data rate was cached, see ageDR().
+  bool modemAsleep = false; ///< The modem sleeps and is woken by the next command.
+  unsigned long modemSleepEnd = 0; ///< Clock time when the last sleep() of the modem runs out.
+  void (*sleepCallback)(uint32_t mseconds) = NULL; ///< MCU sleep function used by sleepAll().
+  uint32_t wakeLatency = 0; ///< Duration of the last wake() in microseconds.
+  size_t lineLength = 0; ///< Length of the partial line process() collected in buffer.
+  bool txPending = false; ///< An uplink from startSendBytes() waits for its result.
+  unsigned long txStart = 0; ///< Clock time when the last uplink was accepted by the modem.
+  unsigned long txTimeout = TTN_DEFAULT_TIMEOUT; ///< Time the pending uplink may take, see getTxTimeout().
+  unsigned long (*clock)(void) = millis; ///< Monotonic clock for all timeouts, see setClock().
+  bool vddPending = false; ///< A VDD query from startGetVDD() waits for its answer.
+  unsigned long vddStart = 0; ///< Clock time when the pending VDD query was sent.
+  bool vddWaking = false; ///< startGetVDD() sent the wake-up sync before the query.
+  uint32_t vddWakeStart = 0; ///< micros() when startGetVDD() sent the wake-up sync.
+  uint16_t lastVDD = 0; ///< Last VDD reading in millivolts.
 
   void clearReadBuffer();
   size_t readLine(char *buffer, size_t size, uint8_t attempts = 3);
@@ -190,6 +271,7 @@ private:
   void debugPrintMessage(uint8_t type, uint8_t index, const char *value = NULL);
 
   void autoBaud();
+  bool fastWake();
   void configureEU868();
   /* Next all removed because EU868 is used.
   void configureUS915(uint8_t fsb);
@@ -211,6 +293,16 @@ private:
   bool sendChSet(uint8_t index, uint8_t channel, const char *value);
   bool sendJoinSet(uint8_t type);
   bool sendPayload(uint8_t mode, uint8_t port, uint8_t *payload, size_t len);
+  void beginPayload(uint8_t mode, uint8_t port);
+  bool endPayload();
+  ttn_response_t readTxResponse(bool confirm);
+  ttn_response_t handleLine();
+  void finishPending();
+  unsigned long getTxTimeout(bool confirm);
+  void ageDR();
+  ttn_response_t sendFrame(const uint8_t *payload, size_t length, port_t port, bool confirm);
+  size_t buildFragment();
+  ttn_response_t sendFragment(bool wait);
   void sendGetValue(uint8_t table, uint8_t prefix, uint8_t index);
 
 public:
@@ -242,6 +334,9 @@ public:
   size_t getVersion(char *buffer, size_t size);
   enum ttn_modem_status_t getStatus();
   uint16_t getVDD(); 
+  void startGetVDD();
+  bool isVDDPending();
+  uint16_t getLastVDD();
 
   // int16_t getRSSI();
   // uint32_t getFrequency();
@@ -252,7 +347,8 @@ public:
   // uint8_t getCR();
   // int8_t getPower();
   // int8_t getSNR();
-  // int8_t getDR();
+  int8_t getDR();
+  uint8_t getMaxPayload();
   // int8_t getPowerIndex();
   // bool getChannelStatus (uint8_t channel);
   // ttn_response_code_t getLastError();
@@ -266,9 +362,24 @@ public:
   bool personalize(); 
   //bool setClass(lorawan_class_t p_lw_class); // Used in join function
   ttn_response_t sendBytes(const uint8_t *payload, size_t length, port_t port = 1, bool confirm = false, uint8_t sf = 0); 
+  ttn_response_t sendBytes(const Printable &payload, port_t port = 1, bool confirm = false);
+  void setFragmentation(bool enabled, port_t port = TTN_FRAGMENT_PORT);
+  ttn_response_t startFragments(const uint8_t *payload, size_t length, port_t port = 1, bool confirm = false);
+  ttn_response_t sendNextFragment();
+  ttn_response_t startNextFragment();
+  bool isFragmenting();
+  ttn_response_t startSendBytes(const uint8_t *payload, size_t length, port_t port = 1, bool confirm = false);
+  bool isSending();
+  ttn_response_t sendUrgent(const uint8_t *payload, size_t length, port_t port = 1, bool confirm = false, uint8_t retries = TTN_URGENT_RETRIES);
+  unsigned long getTxStartTime();
+  ttn_response_t process();
   ttn_response_t poll(port_t port = 1, bool confirm = false, bool modem_only = false);
   void sleep(uint32_t mseconds);
   void wake(); 
+  uint32_t getWakeLatency();
+  void onSleep(void (*cb)(uint32_t mseconds));
+  void setClock(unsigned long (*cb)(void));
+  bool sleepAll(uint32_t mseconds, uint32_t guard = 0);
   void saveState(); 
   void linkCheck(uint16_t seconds);
   uint8_t getLinkCheckGateways(); 